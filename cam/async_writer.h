@@ -0,0 +1,402 @@
+#pragma once
+
+// 异步帧写盘后端
+//  - io_uring：openat/write/close 以链接请求一次提交，文件描述符使用 direct
+//    descriptor（不进入进程 fd 表），缓冲池可注册为 fixed buffer，批量提交、多个写同时在途。
+//    编译需 -DHAVE_LIBURING -luring，内核 6.0 以上。
+//  - 线程池 pwrite：内核或编译环境不支持 io_uring 时的回退方案。
+// 写完成后在后端线程中回调 on_done(slot, result, ctx)，由调用方归还缓冲池中的 slot。
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+enum class WriterBackend { Auto, IoUring, ThreadPool };
+
+typedef void (*WriteDoneFn)(int slot, ssize_t result, void* ctx);
+
+struct WriterStats {
+    std::atomic<uint64_t> ops{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> latency_sum_us{0};
+    std::atomic<uint64_t> latency_max_us{0};
+    std::atomic<int> in_flight{0};
+    std::atomic<int> in_flight_peak{0};
+    std::atomic<uint64_t> submit_calls{0};    // io_uring 实际进入内核的提交次数
+
+    void start_op() {
+        int n = ++in_flight;
+        int peak = in_flight_peak.load();
+        while (n > peak && !in_flight_peak.compare_exchange_weak(peak, n)) {}
+    }
+
+    void finish_op(ssize_t result, size_t expected, uint64_t latency_us) {
+        --in_flight;
+        ops++;
+        if (result < 0 || size_t(result) != expected) errors++;
+        else bytes += expected;
+        latency_sum_us += latency_us;
+        uint64_t mx = latency_max_us.load();
+        while (latency_us > mx && !latency_max_us.compare_exchange_weak(mx, latency_us)) {}
+    }
+
+    void print(const char* name, double wall_sec) const {
+        double mb = bytes.load() / (1024.0 * 1024.0);
+        printf("写盘后端 %s: %llu 次写，%.1f MB，%.1f MB/s，错误 %llu\n", name,
+               (unsigned long long)ops.load(), mb, wall_sec > 0 ? mb / wall_sec : 0.0,
+               (unsigned long long)errors.load());
+        printf("  写延迟: 平均 %.2f ms，最大 %.2f ms；在途峰值 %d\n",
+               ops ? latency_sum_us.load() / 1000.0 / ops.load() : 0.0,
+               latency_max_us.load() / 1000.0, in_flight_peak.load());
+        if (submit_calls)
+            printf("  内核提交 %llu 次，平均每次 %.1f 帧\n", (unsigned long long)submit_calls.load(),
+                   double(ops.load()) / submit_calls.load());
+    }
+};
+
+static inline uint64_t writer_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class FrameWriter {
+public:
+    FrameWriter(int slots, WriteDoneFn done, void* ctx)
+        : requests(slots), on_done(done), done_ctx(ctx) {}
+    virtual ~FrameWriter() {}
+
+    // 把 data[0, size) 写成文件 path；slot 在完成回调前不得复用
+    virtual bool write_file(const char* path, int slot, const void* data, size_t size) = 0;
+    // 提交已排队但尚未进入内核的请求（调用方即将空闲时调用）
+    virtual void submit() {}
+    // 等待所有在途写完成
+    virtual void drain() = 0;
+    virtual const char* name() const = 0;
+
+    WriterStats stats;
+
+protected:
+    struct Request {
+        char path[256];
+        const void* data = nullptr;
+        size_t size = 0;
+        uint64_t start_us = 0;
+        ssize_t result = 0;
+    };
+
+    Request& prepare(const char* path, int slot, const void* data, size_t size) {
+        Request& r = requests[slot];
+        snprintf(r.path, sizeof(r.path), "%s", path);
+        r.data = data;
+        r.size = size;
+        r.result = 0;
+        r.start_us = writer_now_us();
+        stats.start_op();
+        return r;
+    }
+
+    void complete(int slot) {
+        Request& r = requests[slot];
+        stats.finish_op(r.result, r.size, writer_now_us() - r.start_us);
+        on_done(slot, r.result, done_ctx);
+    }
+
+    std::vector<Request> requests;   // 按 slot 下标，一个 slot 同时最多一个请求
+
+private:
+    WriteDoneFn on_done;
+    void* done_ctx;
+};
+
+// ========================= 线程池 pwrite =========================
+class ThreadPoolWriter : public FrameWriter {
+public:
+    ThreadPoolWriter(int slots, WriteDoneFn done, void* ctx, int n_threads)
+        : FrameWriter(slots, done, ctx), ring(slots) {
+        for (int i = 0; i < n_threads; ++i)
+            workers.emplace_back(&ThreadPoolWriter::worker, this);
+    }
+
+    ~ThreadPoolWriter() override {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            quit = true;
+        }
+        cv.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    bool write_file(const char* path, int slot, const void* data, size_t size) override {
+        prepare(path, slot, data, size);
+        {
+            std::lock_guard<std::mutex> lock(m);
+            ring[(head + count) % ring.size()] = slot;
+            count++;
+            pending++;
+        }
+        cv.notify_one();
+        return true;
+    }
+
+    void drain() override {
+        std::unique_lock<std::mutex> lock(m);
+        idle.wait(lock, [this] { return pending == 0; });
+    }
+
+    const char* name() const override { return "pwrite 线程池"; }
+
+private:
+    void worker() {
+        std::unique_lock<std::mutex> lock(m);
+        for (;;) {
+            cv.wait(lock, [this] { return count > 0 || quit; });
+            if (count == 0) return;
+            int slot = ring[head];
+            head = (head + 1) % ring.size();
+            count--;
+            lock.unlock();
+
+            Request& r = requests[slot];
+            int fd = open(r.path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                r.result = -errno;
+            } else {
+                size_t done = 0;
+                while (done < r.size) {
+                    ssize_t n = pwrite(fd, static_cast<const char*>(r.data) + done, r.size - done, done);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) break;
+                    done += n;
+                }
+                r.result = done == r.size ? ssize_t(done) : -EIO;
+                if (close(fd) < 0) r.result = -errno;
+            }
+            complete(slot);
+
+            lock.lock();
+            if (--pending == 0) idle.notify_all();
+        }
+    }
+
+    std::vector<int> ring;
+    size_t head = 0;
+    size_t count = 0;
+    int pending = 0;
+    bool quit = false;
+    std::mutex m;
+    std::condition_variable cv;
+    std::condition_variable idle;
+    std::vector<std::thread> workers;
+};
+
+// ========================= io_uring =========================
+#ifdef HAVE_LIBURING
+class IoUringWriter : public FrameWriter {
+public:
+    // buffers 非空时注册为 fixed buffer（每个 slot 一个），写入使用 write_fixed
+    IoUringWriter(int slots, WriteDoneFn done, void* ctx, unsigned char* const* buffers, size_t buf_len)
+        : FrameWriter(slots, done, ctx) {
+        // 每次写文件占用 3 个 SQE：openat -> write -> close
+        if (io_uring_queue_init(slots * 3, &ring, 0) < 0) return;
+        if (io_uring_register_files_sparse(&ring, slots) < 0) {
+            io_uring_queue_exit(&ring);
+            return;
+        }
+        if (buffers) {
+            std::vector<iovec> iov(slots);
+            for (int i = 0; i < slots; ++i) {
+                iov[i].iov_base = buffers[i];
+                iov[i].iov_len = buf_len;
+            }
+            fixed_buffers = io_uring_register_buffers(&ring, iov.data(), slots) == 0;
+            if (fixed_buffers) {
+                buf_begin.assign(buffers, buffers + slots);
+                buf_size = buf_len;
+            }
+        }
+        ok = true;
+        reaper = std::thread(&IoUringWriter::reap, this);
+    }
+
+    ~IoUringWriter() override {
+        if (!ok) return;
+        drain();
+        // 提交一个 NOP 唤醒收割线程退出（drain 之后 SQ 已空，总能取到 SQE）
+        {
+            std::lock_guard<std::mutex> lock(sq_mutex);
+            reserve_locked(1);
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_nop(sqe);
+            io_uring_sqe_set_data64(sqe, QUIT_TAG);
+            io_uring_submit(&ring);
+        }
+        reaper.join();
+        io_uring_queue_exit(&ring);
+    }
+
+    bool valid() const { return ok; }
+
+    bool write_file(const char* path, int slot, const void* data, size_t size) override {
+        Request& r = prepare(path, slot, data, size);
+        std::unique_lock<std::mutex> lock(sq_mutex);
+        // 三个 SQE 必须在同一次提交里，否则链会被拆开；取不到时这一帧按失败完成，slot 照常归还
+        if (!reserve_locked(3)) {
+            lock.unlock();
+            r.result = -EBUSY;
+            complete(slot);
+            return false;
+        }
+
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_openat_direct(sqe, AT_FDCWD, r.path, O_WRONLY | O_CREAT | O_TRUNC, 0644, slot);
+        sqe->flags |= IOSQE_IO_LINK;
+        io_uring_sqe_set_data64(sqe, tag(slot, OP_OPEN));
+
+        sqe = io_uring_get_sqe(&ring);
+        if (fixed_buffers && in_slot_buffer(slot, data, size))
+            io_uring_prep_write_fixed(sqe, slot, data, size, 0, slot);
+        else
+            io_uring_prep_write(sqe, slot, data, size, 0);
+        sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+        io_uring_sqe_set_data64(sqe, tag(slot, OP_WRITE));
+
+        sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_close_direct(sqe, slot);
+        io_uring_sqe_set_data64(sqe, tag(slot, OP_CLOSE));
+
+        pending++;
+        unsubmitted++;
+        if (unsubmitted >= SUBMIT_BATCH) flush_locked();
+        return true;
+    }
+
+    void submit() override {
+        std::lock_guard<std::mutex> lock(sq_mutex);
+        flush_locked();
+    }
+
+    void drain() override {
+        submit();
+        std::unique_lock<std::mutex> lock(done_mutex);
+        idle.wait(lock, [this] { return pending.load() == 0; });
+    }
+
+    const char* name() const override { return fixed_buffers ? "io_uring (fixed buffers)" : "io_uring"; }
+
+private:
+    enum { OP_OPEN = 0, OP_WRITE = 1, OP_CLOSE = 2 };
+    static constexpr uint64_t QUIT_TAG = ~0ull;
+    static constexpr int SUBMIT_BATCH = 4;   // 攒够几帧再进入内核
+    static constexpr int SQ_RETRIES = 100;
+
+    static uint64_t tag(int slot, int op) { return (uint64_t(slot) << 2) | op; }
+
+    bool in_slot_buffer(int slot, const void* data, size_t size) const {
+        auto p = static_cast<const unsigned char*>(data);
+        return p >= buf_begin[slot] && p + size <= buf_begin[slot] + buf_size;
+    }
+
+    // 确保 SQ 至少有 n 个空位：不够时先提交已排队的请求（没有 SQPOLL，提交返回时内核已取走它们）。
+    // CQ 溢出等原因提交暂时失败时让出 CPU 等收割线程处理，重试几次仍不行返回 false
+    bool reserve_locked(unsigned n) {
+        for (int attempt = 0; io_uring_sq_space_left(&ring) < n; ++attempt) {
+            if (attempt == SQ_RETRIES) return false;
+            int ret = io_uring_submit(&ring);
+            stats.submit_calls++;
+            if (ret >= 0) unsubmitted = 0;
+            else if (ret == -EBUSY || ret == -EAGAIN || ret == -EINTR) std::this_thread::yield();
+            else return false;
+        }
+        return true;
+    }
+
+    void flush_locked() {
+        if (unsubmitted == 0) return;
+        io_uring_submit(&ring);
+        stats.submit_calls++;
+        unsubmitted = 0;
+    }
+
+    void reap() {
+        for (;;) {
+            io_uring_cqe* cqe;
+            int ret = io_uring_wait_cqe(&ring, &cqe);
+            if (ret == -EINTR) continue;
+            if (ret < 0) break;
+
+            uint64_t data = io_uring_cqe_get_data64(cqe);
+            int res = cqe->res;
+            io_uring_cqe_seen(&ring, cqe);
+            if (data == QUIT_TAG) break;
+
+            int slot = int(data >> 2);
+            Request& r = requests[slot];
+            switch (data & 3) {
+            case OP_OPEN:
+                if (res < 0) r.result = res;
+                break;
+            case OP_WRITE:
+                if (r.result >= 0) r.result = res;
+                break;
+            case OP_CLOSE:
+                // 链上前面的请求失败时 close 会以 -ECANCELED 结束，以最早的错误为准
+                if (res < 0 && r.result >= 0) r.result = res;
+                complete(slot);
+                if (--pending == 0) {
+                    std::lock_guard<std::mutex> lock(done_mutex);
+                    idle.notify_all();
+                }
+                break;
+            }
+        }
+    }
+
+    io_uring ring;
+    bool ok = false;
+    bool fixed_buffers = false;
+    std::vector<unsigned char*> buf_begin;
+    size_t buf_size = 0;
+
+    std::mutex sq_mutex;
+    int unsubmitted = 0;
+    std::atomic<int> pending{0};
+    std::mutex done_mutex;
+    std::condition_variable idle;
+    std::thread reaper;
+};
+#endif
+
+// 按配置创建写盘后端；Auto 时优先 io_uring，初始化失败（内核不支持等）回退到线程池
+static inline std::unique_ptr<FrameWriter> make_frame_writer(WriterBackend backend, int slots,
+                                                             WriteDoneFn done, void* ctx,
+                                                             unsigned char* const* buffers,
+                                                             size_t buf_len, int threads) {
+#ifdef HAVE_LIBURING
+    if (backend != WriterBackend::ThreadPool) {
+        std::unique_ptr<IoUringWriter> w(new IoUringWriter(slots, done, ctx, buffers, buf_len));
+        if (w->valid()) return std::unique_ptr<FrameWriter>(w.release());
+        fprintf(stderr, "io_uring 不可用，回退到 pwrite 线程池\n");
+    }
+#else
+    (void)buffers;
+    (void)buf_len;
+    if (backend == WriterBackend::IoUring)
+        fprintf(stderr, "未编译 io_uring 支持（-DHAVE_LIBURING -luring），使用 pwrite 线程池\n");
+#endif
+    return std::unique_ptr<FrameWriter>(new ThreadPoolWriter(slots, done, ctx, threads));
+}
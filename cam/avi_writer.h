@@ -0,0 +1,182 @@
+#pragma once
+
+// 最简 AVI 1.0（RIFF）MJPEG 写入：单路视频流，每帧一个 '00dc' 块，结尾写 idx1 索引。
+// AVI 1.0 的 RIFF 长度是 32 位，单文件超过 AVI_MAX_BYTES 后 full() 返回 true，
+// 调用方应关闭并换下一个文件。
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define AVI_MAX_BYTES (1900ull * 1024 * 1024)
+
+class AviWriter {
+public:
+    ~AviWriter() { close(); }
+
+    bool open(const char* path, int w, int h, double fps) {
+        fp = fopen(path, "wb");
+        if (!fp) {
+            perror("无法创建AVI文件");
+            return false;
+        }
+        width = w;
+        height = h;
+        frame_rate = fps > 0 ? fps : 30.0;
+        frames = 0;
+        max_frame = 0;
+        index.clear();
+        // 文件头先按 0 帧写出，close() 时回填长度字段
+        return write_headers() && start_movi();
+    }
+
+    bool add_frame(const void* jpeg, size_t size) {
+        if (!fp) return false;
+        uint64_t offset = uint64_t(ftello(fp));
+        uint8_t hdr[8];
+        memcpy(hdr, "00dc", 4);
+        put32(hdr + 4, uint32_t(size));
+        static const uint8_t pad = 0;
+        if (fwrite(hdr, 1, 8, fp) != 8 || fwrite(jpeg, 1, size, fp) != size ||
+            ((size & 1) && fwrite(&pad, 1, 1, fp) != 1)) {
+            perror("写AVI帧失败");
+            return false;
+        }
+        // idx1 中的偏移相对于 'movi' 标识
+        index.push_back({uint32_t(offset - movi_fourcc_pos), uint32_t(size)});
+        frames++;
+        if (size > max_frame) max_frame = uint32_t(size);
+        return true;
+    }
+
+    bool full() const { return fp && uint64_t(ftello(fp)) + 16ull * index.size() >= AVI_MAX_BYTES; }
+
+    bool close() {
+        if (!fp) return true;
+        bool ok = finish();
+        if (fclose(fp) != 0) ok = false;
+        fp = nullptr;
+        return ok;
+    }
+
+    uint32_t frame_count() const { return frames; }
+
+private:
+    struct IndexEntry {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    static void put32(uint8_t* p, uint32_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+        p[2] = v >> 16;
+        p[3] = v >> 24;
+    }
+    static void put16(uint8_t* p, uint16_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+    }
+
+    // RIFF/hdrl 头部固定 212 字节：RIFF(12) + LIST hdrl(12) + avih(8+56) + LIST strl(12) + strh(8+56) + strf(8+40)
+    enum { HEADER_SIZE = 212, AVIH_POS = 32, STRH_POS = 108 };
+
+    bool write_headers() {
+        uint8_t h[HEADER_SIZE];
+        memset(h, 0, sizeof(h));
+        uint8_t* p = h;
+        memcpy(p, "RIFF", 4);  p += 8;           // 长度回填
+        memcpy(p, "AVI ", 4);  p += 4;
+        memcpy(p, "LIST", 4);  put32(p + 4, HEADER_SIZE - 20); p += 8;
+        memcpy(p, "hdrl", 4);  p += 4;
+
+        memcpy(p, "avih", 4);  put32(p + 4, 56); p += 8;
+        put32(p + 0, uint32_t(1e6 / frame_rate + 0.5));   // dwMicroSecPerFrame
+        put32(p + 12, 0x10);                              // AVIF_HASINDEX
+        put32(p + 24, 1);                                 // dwStreams
+        put32(p + 32, uint32_t(width));
+        put32(p + 36, uint32_t(height));
+        p += 56;
+
+        memcpy(p, "LIST", 4);  put32(p + 4, 4 + 64 + 48); p += 8;
+        memcpy(p, "strl", 4);  p += 4;
+
+        memcpy(p, "strh", 4);  put32(p + 4, 56); p += 8;
+        memcpy(p + 0, "vids", 4);
+        memcpy(p + 4, "MJPG", 4);
+        put32(p + 20, 1000);                              // dwScale
+        put32(p + 24, uint32_t(frame_rate * 1000 + 0.5)); // dwRate
+        put32(p + 40, 0xFFFFFFFFu);                       // dwQuality
+        put16(p + 52, uint16_t(width));                   // rcFrame.right
+        put16(p + 54, uint16_t(height));                  // rcFrame.bottom
+        p += 56;
+
+        memcpy(p, "strf", 4);  put32(p + 4, 40); p += 8;
+        put32(p + 0, 40);
+        put32(p + 4, uint32_t(width));
+        put32(p + 8, uint32_t(height));
+        put16(p + 12, 1);
+        put16(p + 14, 24);
+        memcpy(p + 16, "MJPG", 4);
+        put32(p + 20, uint32_t(width * height * 3));
+        p += 40;
+
+        if (fwrite(h, 1, sizeof(h), fp) != sizeof(h)) {
+            perror("写AVI文件头失败");
+            return false;
+        }
+        return true;
+    }
+
+    bool start_movi() {
+        uint8_t h[12];
+        memcpy(h, "LIST", 4);
+        put32(h + 4, 0);
+        memcpy(h + 8, "movi", 4);
+        movi_list_pos = uint64_t(ftello(fp));
+        movi_fourcc_pos = movi_list_pos + 8;
+        return fwrite(h, 1, 12, fp) == 12;
+    }
+
+    bool finish() {
+        uint64_t movi_end = uint64_t(ftello(fp));
+
+        std::vector<uint8_t> idx(8 + 16 * index.size());
+        memcpy(idx.data(), "idx1", 4);
+        put32(idx.data() + 4, uint32_t(16 * index.size()));
+        for (size_t i = 0; i < index.size(); ++i) {
+            uint8_t* e = idx.data() + 8 + 16 * i;
+            memcpy(e, "00dc", 4);
+            put32(e + 4, 0x10);                       // AVIIF_KEYFRAME
+            put32(e + 8, index[i].offset);
+            put32(e + 12, index[i].size);
+        }
+        if (fwrite(idx.data(), 1, idx.size(), fp) != idx.size()) return false;
+        uint64_t file_end = uint64_t(ftello(fp));
+
+        uint8_t v[4];
+        auto patch = [&](uint64_t pos, uint32_t value) {
+            put32(v, value);
+            return fseeko(fp, off_t(pos), SEEK_SET) == 0 && fwrite(v, 1, 4, fp) == 4;
+        };
+        bool ok = patch(4, uint32_t(file_end - 8)) &&
+                  patch(movi_list_pos + 4, uint32_t(movi_end - movi_list_pos - 8)) &&
+                  patch(AVIH_POS + 16, frames) &&                 // dwTotalFrames
+                  patch(AVIH_POS + 28, max_frame + 8) &&          // dwSuggestedBufferSize
+                  patch(STRH_POS + 32, frames) &&                 // dwLength
+                  patch(STRH_POS + 36, max_frame + 8);
+        fseeko(fp, 0, SEEK_END);
+        return ok;
+    }
+
+    FILE* fp = nullptr;
+    int width = 0;
+    int height = 0;
+    double frame_rate = 30.0;
+    uint32_t frames = 0;
+    uint32_t max_frame = 0;
+    uint64_t movi_list_pos = 0;
+    uint64_t movi_fourcc_pos = 0;
+    std::vector<IndexEntry> index;
+};
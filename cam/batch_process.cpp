@@ -0,0 +1,211 @@
+// 录制归档的离线批处理：所有核心并行解码和处理，帧数据从 mmap 区直接交给 imdecode
+// 用法: batch_process [-j 线程数] [-r 1|2|4|8] [-s 步长] <归档> <模式> [参数]
+//   归档: .mjc 录制文件或 JPEG 目录（如 captured_frames）
+//   bench                      只解码，测量吞吐
+//   stats [输出.csv]           每帧亮度均值、标准差、清晰度（拉普拉斯方差）
+//   dataset <目录> x,y,w,h     裁剪 ROI 保存为 PNG（坐标按原图，-r 缩小时自动换算）
+//   -r 以 1/2、1/4、1/8 分辨率解码（libjpeg 在 DCT 阶段缩小，速度快得多）
+// 编译: g++ -O3 -std=c++17 batch_process.cpp -o batch_process -I/usr/include/opencv4
+//       -lopencv_core -lopencv_imgproc -lopencv_imgcodecs -lpthread
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include "frame_archive.h"
+
+using namespace cv;
+using namespace std;
+
+#define BATCH_CHUNK 4   // 每个线程一次领取的帧数
+
+enum class Mode { Bench, Stats, Dataset };
+
+struct FrameResult {
+    bool ok = false;
+    double mean = 0;
+    double stddev = 0;
+    double sharpness = 0;
+};
+
+struct Job {
+    const FrameArchive* archive;
+    Mode mode;
+    int reduce;
+    size_t step;
+    Rect roi;
+    string out_dir;
+    vector<FrameResult> results;
+    atomic<size_t> next{0};
+    atomic<uint64_t> bytes{0};
+    atomic<int> failed{0};
+};
+
+static int imread_flags(int reduce, bool gray) {
+    switch (reduce) {
+    case 2: return gray ? IMREAD_REDUCED_GRAYSCALE_2 : IMREAD_REDUCED_COLOR_2;
+    case 4: return gray ? IMREAD_REDUCED_GRAYSCALE_4 : IMREAD_REDUCED_COLOR_4;
+    case 8: return gray ? IMREAD_REDUCED_GRAYSCALE_8 : IMREAD_REDUCED_COLOR_8;
+    default: return gray ? IMREAD_GRAYSCALE : IMREAD_COLOR;
+    }
+}
+
+static void process_frame(Job& job, size_t i, Mat& lap) {
+    FrameView view = job.archive->frame(i);
+    if (!view.valid()) {
+        job.failed++;
+        return;
+    }
+    job.bytes += view.size;
+
+    // 直接包装映射区，不拷贝
+    Mat encoded(1, int(view.size), CV_8UC1, const_cast<uint8_t*>(view.data));
+    Mat img = imdecode(encoded, imread_flags(job.reduce, job.mode != Mode::Dataset));
+    if (img.empty()) {
+        job.failed++;
+        return;
+    }
+
+    FrameResult& r = job.results[i];
+    switch (job.mode) {
+    case Mode::Bench:
+        break;
+    case Mode::Stats: {
+        Scalar mean, stddev;
+        meanStdDev(img, mean, stddev);
+        Laplacian(img, lap, CV_16S);
+        Scalar lm, ls;
+        meanStdDev(lap, lm, ls);
+        r.mean = mean[0];
+        r.stddev = stddev[0];
+        r.sharpness = ls[0] * ls[0];
+        break;
+    }
+    case Mode::Dataset: {
+        Rect roi(job.roi.x / job.reduce, job.roi.y / job.reduce,
+                 job.roi.width / job.reduce, job.roi.height / job.reduce);
+        roi &= Rect(0, 0, img.cols, img.rows);
+        char name[64];
+        snprintf(name, sizeof(name), "/%08zu_seq%u.png", i, view.sequence);
+        if (roi.empty() || !imwrite(job.out_dir + name, img(roi))) {
+            job.failed++;
+            return;
+        }
+        break;
+    }
+    }
+    r.ok = true;
+}
+
+static void worker(Job* job) {
+    Mat lap;
+    size_t n = job->archive->frame_count();
+    for (;;) {
+        size_t first = job->next.fetch_add(BATCH_CHUNK);
+        if (first * job->step >= n) break;
+        for (size_t k = first; k < first + BATCH_CHUNK && k * job->step < n; ++k)
+            process_frame(*job, k * job->step, lap);
+    }
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "用法: %s [-j 线程数] [-r 1|2|4|8] [-s 步长] <归档> bench|stats [输出.csv]|dataset <目录> x,y,w,h\n",
+            prog);
+}
+
+int main(int argc, char** argv) {
+    int threads = int(thread::hardware_concurrency());
+    int reduce = 1;
+    size_t step = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:r:s:h")) != -1) {
+        switch (opt) {
+        case 'j': threads = atoi(optarg); break;
+        case 'r': reduce = atoi(optarg); break;
+        case 's': step = strtoul(optarg, nullptr, 10); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (argc - optind < 2 || threads < 1 || step < 1 ||
+        (reduce != 1 && reduce != 2 && reduce != 4 && reduce != 8)) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    FrameArchive archive;
+    auto t_open = chrono::steady_clock::now();
+    if (!archive.open(argv[optind])) return -1;
+    double open_sec = chrono::duration<double>(chrono::steady_clock::now() - t_open).count();
+
+    Job job;
+    job.archive = &archive;
+    job.reduce = reduce;
+    job.step = step;
+    const char* mode = argv[optind + 1];
+    const char* csv_path = nullptr;
+    if (strcmp(mode, "bench") == 0) {
+        job.mode = Mode::Bench;
+    } else if (strcmp(mode, "stats") == 0) {
+        job.mode = Mode::Stats;
+        csv_path = argc - optind > 2 ? argv[optind + 2] : nullptr;
+    } else if (strcmp(mode, "dataset") == 0 && argc - optind > 3) {
+        job.mode = Mode::Dataset;
+        job.out_dir = argv[optind + 2];
+        if (sscanf(argv[optind + 3], "%d,%d,%d,%d", &job.roi.x, &job.roi.y, &job.roi.width, &job.roi.height) != 4) {
+            usage(argv[0]);
+            return -1;
+        }
+        mkdir(job.out_dir.c_str(), 0755);
+    } else {
+        usage(argv[0]);
+        return -1;
+    }
+    job.results.resize(archive.frame_count());
+
+    printf("%s: %zu 帧（%s，索引耗时 %.3f 秒），%d 线程，1/%d 解码\n", argv[optind], archive.frame_count(),
+           archive.is_container() ? "mjc 容器" : "JPEG 目录", open_sec, threads, reduce);
+
+    // 并行在帧级别进行，关闭 OpenCV 内部的多线程以免线程数超订
+    setNumThreads(1);
+    auto t0 = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int i = 0; i < threads; ++i) pool.emplace_back(worker, &job);
+    for (auto& t : pool) t.join();
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    size_t processed = (archive.frame_count() + step - 1) / step;
+    double span = archive.duration_sec();
+    printf("处理 %zu 帧，失败 %d，%.2f 秒，%.1f 帧/秒，%.1f MB/s",
+           processed, job.failed.load(), wall, processed / wall, job.bytes / (1024.0 * 1024.0) / wall);
+    if (span > 0) printf("，相当于实时的 %.1f 倍", span / wall);
+    printf("\n");
+
+    if (job.mode == Mode::Stats) {
+        FILE* fp = csv_path ? fopen(csv_path, "w") : stdout;
+        if (!fp) {
+            perror(csv_path);
+            return -1;
+        }
+        fprintf(fp, "frame,sequence,time_s,mean,stddev,sharpness\n");
+        uint64_t t_first = archive.frame_count() ? archive.timestamp_ns(0) : 0;
+        for (size_t i = 0; i < archive.frame_count(); i += step) {
+            const FrameResult& r = job.results[i];
+            if (!r.ok) continue;
+            fprintf(fp, "%zu,%u,%.3f,%.2f,%.2f,%.1f\n", i, archive.sequence(i),
+                    (archive.timestamp_ns(i) - t_first) / 1e9, r.mean, r.stddev, r.sharpness);
+        }
+        if (fp != stdout) fclose(fp);
+    }
+    return 0;
+}
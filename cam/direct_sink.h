@@ -0,0 +1,274 @@
+#pragma once
+
+// O_DIRECT 顺序写入目标：数据先拼进按页对齐的大块缓冲，写满一块后交给写盘线程
+// 以 O_DIRECT 整块写出，同时继续填充另一块（双缓冲）。文件按 DIRECT_PREALLOC_STEP
+// 用 fallocate 预分配（FALLOC_FL_KEEP_SIZE），减少长时间录制的碎片和元数据更新。
+// 不经过页缓存，录制时不会挤掉 OCR 等进程需要的缓存。
+// 文件系统不支持 O_DIRECT（如 tmpfs）时回退为普通写入。
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "mjpeg_container.h"
+
+#define DIRECT_ALIGN         4096
+#define DIRECT_BLOCK         (8 * 1024 * 1024)
+#define DIRECT_PREALLOC_STEP (256ull * 1024 * 1024)
+
+// 写入统计，可由多个分段文件共用一份
+struct DirectSinkStats {
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> io_busy_us{0};
+    std::atomic<uint64_t> wait_us{0};       // 填充线程等待写盘线程的时间
+    std::atomic<uint64_t> preallocated{0};
+    std::atomic<int> files{0};
+    std::atomic<int> buffered_files{0};     // 不支持 O_DIRECT 而回退的文件数
+
+    void print(double wall_sec) const {
+        double mb = bytes / (1024.0 * 1024.0);
+        printf("O_DIRECT 写入: %d 个文件（%d 个回退为普通写入），%.1f MB，%.1f MB/s\n",
+               files.load(), buffered_files.load(), mb, wall_sec > 0 ? mb / wall_sec : 0.0);
+        printf("  写盘线程忙 %.1f%%，填充等待写盘 %.3f 秒，预分配 %.0f MB\n",
+               wall_sec > 0 ? io_busy_us / 1e4 / wall_sec : 0.0, wait_us / 1e6,
+               preallocated / (1024.0 * 1024.0));
+    }
+};
+
+class DirectSink : public ByteSink {
+public:
+    ~DirectSink() override { close(); }
+
+    // prealloc 为首次预分配的字节数（例如分段大小），0 时使用 DIRECT_PREALLOC_STEP；
+    // shared 非空时统计累加到调用方提供的结构
+    bool open(const char* path, uint64_t prealloc, DirectSinkStats* shared = nullptr) {
+        if (shared) stats = shared;
+        // 回写文件头时可能需要读改写，以读写方式打开
+        fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+        direct = fd >= 0;
+        if (fd < 0 && errno == EINVAL)
+            fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            perror("无法创建录制文件");
+            return false;
+        }
+        if (!direct) {
+            fprintf(stderr, "%s 所在文件系统不支持 O_DIRECT，使用普通写入\n", path);
+            stats->buffered_files++;
+        }
+        stats->files++;
+
+        for (auto& b : bufs) {
+            if (posix_memalign(reinterpret_cast<void**>(&b), DIRECT_ALIGN, DIRECT_BLOCK) != 0) {
+                b = nullptr;
+                close();
+                return false;
+            }
+        }
+        cur = bufs[0];
+        prealloc_step = prealloc ? prealloc : DIRECT_PREALLOC_STEP;
+        reserve(prealloc_step);
+        io_thread = std::thread(&DirectSink::io_loop, this);
+        return true;
+    }
+
+    bool append(const iovec* iov, int iovcnt) override {
+        for (int i = 0; i < iovcnt; ++i) {
+            const uint8_t* p = static_cast<const uint8_t*>(iov[i].iov_base);
+            size_t left = iov[i].iov_len;
+            while (left > 0) {
+                size_t n = std::min(left, size_t(DIRECT_BLOCK) - fill);
+                memcpy(cur + fill, p, n);
+                fill += n;
+                p += n;
+                left -= n;
+                if (fill == DIRECT_BLOCK && !submit_block()) return false;
+            }
+        }
+        return !io_error;
+    }
+
+    // 只用于回写文件头等小块：目标还在缓冲里时直接修改缓冲，否则按页读改写
+    bool write_at(uint64_t offset, const void* data, size_t size) override {
+        wait_idle();
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            uint64_t page = offset & ~uint64_t(DIRECT_ALIGN - 1);
+            size_t in_page = size_t(offset - page);
+            size_t n = std::min(size, size_t(DIRECT_ALIGN) - in_page);
+            if (page >= block_off) {
+                memcpy(cur + (offset - block_off), p, n);
+            } else {
+                uint8_t* tmp = bufs[1 - buf_index()];
+                if (!read_page(tmp, page)) return false;
+                memcpy(tmp + in_page, p, n);
+                if (!write_full(tmp, DIRECT_ALIGN, page)) return false;
+            }
+            offset += n;
+            p += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    // 当前块中已有的数据补齐到页边界后写出（之后该块写满时会整块重写），再 fdatasync
+    bool sync() override {
+        wait_idle();
+        if (io_error) return false;
+        if (fill > 0) {
+            size_t len = (fill + DIRECT_ALIGN - 1) & ~size_t(DIRECT_ALIGN - 1);
+            memset(cur + fill, 0, len - fill);
+            if (!write_full(cur, len, block_off)) return false;
+        }
+        return fdatasync(fd) == 0;
+    }
+
+    bool close() override {
+        if (fd < 0) return true;
+        bool ok = true;
+        if (io_thread.joinable()) {
+            ok = sync();
+            {
+                std::lock_guard<std::mutex> lock(m);
+                quit = true;
+            }
+            cv.notify_all();
+            io_thread.join();
+        }
+        // 去掉最后一页的补齐部分，预分配但未用到的空间在截断时释放
+        if (ftruncate(fd, off_t(position())) != 0) ok = false;
+        if (::close(fd) != 0) ok = false;
+        fd = -1;
+        for (auto& b : bufs) {
+            free(b);
+            b = nullptr;
+        }
+        return ok && !io_error;
+    }
+
+    uint64_t position() const override { return block_off + fill; }
+
+    const DirectSinkStats& statistics() const { return *stats; }
+
+private:
+    int buf_index() const { return cur == bufs[0] ? 0 : 1; }
+
+    // 把写满的当前块交给写盘线程，然后切换到另一块缓冲继续填充
+    bool submit_block() {
+        wait_idle();
+        if (io_error) return false;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            io_buf = cur;
+            io_off = block_off;
+            io_pending = true;
+        }
+        cv.notify_all();
+        cur = bufs[1 - buf_index()];
+        block_off += DIRECT_BLOCK;
+        fill = 0;
+        return true;
+    }
+
+    void wait_idle() {
+        auto t0 = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(m);
+        if (!io_pending) return;
+        idle.wait(lock, [this] { return !io_pending; });
+        stats->wait_us += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+    }
+
+    void io_loop() {
+        std::unique_lock<std::mutex> lock(m);
+        for (;;) {
+            cv.wait(lock, [this] { return io_pending || quit; });
+            if (!io_pending) return;
+            lock.unlock();
+
+            auto t0 = std::chrono::steady_clock::now();
+            if (io_off + DIRECT_BLOCK > allocated) reserve(io_off + DIRECT_BLOCK - allocated);
+            if (!write_full(io_buf, DIRECT_BLOCK, io_off)) io_error = true;
+            stats->io_busy_us += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - t0).count();
+
+            lock.lock();
+            io_pending = false;
+            idle.notify_all();
+        }
+    }
+
+    void reserve(uint64_t at_least) {
+        uint64_t len = std::max<uint64_t>(at_least, prealloc_step);
+        // 预分配失败（文件系统不支持）不影响写入
+        if (fallocate(fd, FALLOC_FL_KEEP_SIZE, off_t(allocated), off_t(len)) == 0) {
+            allocated += len;
+            stats->preallocated += len;
+        } else {
+            allocated = UINT64_MAX;
+        }
+    }
+
+    bool write_full(const uint8_t* data, size_t size, uint64_t offset) {
+        while (size > 0) {
+            ssize_t n = pwrite(fd, data, size, off_t(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                perror("O_DIRECT 写入失败");
+                return false;
+            }
+            data += n;
+            size -= n;
+            offset += n;
+            stats->bytes += n;
+        }
+        return true;
+    }
+
+    bool read_page(uint8_t* page_buf, uint64_t offset) {
+        size_t done = 0;
+        while (done < DIRECT_ALIGN) {
+            ssize_t n = pread(fd, page_buf + done, DIRECT_ALIGN - done, off_t(offset + done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return false;
+            if (n == 0) {
+                memset(page_buf + done, 0, DIRECT_ALIGN - done);
+                break;
+            }
+            done += n;
+        }
+        return true;
+    }
+
+    int fd = -1;
+    bool direct = false;
+    uint8_t* bufs[2] = {nullptr, nullptr};
+    uint8_t* cur = nullptr;
+    size_t fill = 0;
+    uint64_t block_off = 0;   // cur 对应的文件偏移
+    uint64_t allocated = 0;
+    uint64_t prealloc_step = DIRECT_PREALLOC_STEP;
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::condition_variable idle;
+    std::thread io_thread;
+    bool io_pending = false;
+    bool quit = false;
+    const uint8_t* io_buf = nullptr;
+    uint64_t io_off = 0;
+    std::atomic<bool> io_error{false};
+
+    DirectSinkStats own_stats;
+    DirectSinkStats* stats = &own_stats;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+// 通过管道把 BGR 原始帧交给 ffmpeg 子进程编码 H.264。
+// 和 cv::VideoWriter 不同，编码或写盘出错都能看到：子进程退出后 write() 返回 EPIPE，
+// close() 检查子进程的退出码（磁盘满时最后的 flush 失败也会反映在这里）。
+// 子进程在调用线程中 fork，继承该线程的 CPU 绑定。
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+class FfmpegPipe {
+public:
+    ~FfmpegPipe() { close(); }
+
+    // 启动 ffmpeg 写 path；ffmpeg 不存在或无法启动时返回 false
+    bool open(const std::string& path, int w, int h, double fps) {
+        close();
+        // 子进程退出后再写管道会收到 SIGPIPE，这里改为由 write() 返回 EPIPE
+        signal(SIGPIPE, SIG_IGN);
+
+        char size[32], rate[32];
+        snprintf(size, sizeof(size), "%dx%d", w, h);
+        snprintf(rate, sizeof(rate), "%.3f", fps > 0 ? fps : 30.0);
+        const char* argv[] = {"ffmpeg", "-hide_banner", "-loglevel", "error", "-y",
+                              "-f", "rawvideo", "-pix_fmt", "bgr24", "-s", size, "-r", rate, "-i", "-",
+                              "-c:v", "libx264", "-preset", "veryfast", "-pix_fmt", "yuv420p",
+                              path.c_str(), nullptr};
+
+        int data[2], status[2];
+        if (pipe2(data, O_CLOEXEC) < 0) {
+            perror("创建编码管道失败");
+            return false;
+        }
+        // exec 成功时 status 管道随 O_CLOEXEC 关闭，父进程读到 EOF；失败时子进程写回 errno
+        if (pipe2(status, O_CLOEXEC) < 0) {
+            perror("创建编码管道失败");
+            ::close(data[0]);
+            ::close(data[1]);
+            return false;
+        }
+        pid = fork();
+        if (pid == 0) {
+            dup2(data[0], STDIN_FILENO);
+            execvp(argv[0], const_cast<char* const*>(argv));
+            int e = errno;
+            (void)!::write(status[1], &e, sizeof(e));
+            _exit(127);
+        }
+        ::close(data[0]);
+        ::close(status[1]);
+        if (pid < 0) {
+            perror("启动 ffmpeg 失败");
+            ::close(data[1]);
+            ::close(status[0]);
+            return false;
+        }
+        int e = 0;
+        ssize_t n;
+        while ((n = read(status[0], &e, sizeof(e))) < 0 && errno == EINTR) {}
+        ::close(status[0]);
+        if (n > 0) {
+            fprintf(stderr, "无法运行 ffmpeg: %s\n", strerror(e));
+            ::close(data[1]);
+            waitpid(pid, nullptr, 0);
+            pid = -1;
+            return false;
+        }
+        fd = data[1];
+        frame_bytes = size_t(w) * h * 3;
+        return true;
+    }
+
+    bool is_open() const { return fd >= 0; }
+
+    // bgr 为 w*h*3 字节的连续 BGR 图像；编码器已退出或写入出错时返回 false
+    bool write(const uint8_t* bgr) {
+        if (fd < 0) return false;
+        size_t done = 0;
+        while (done < frame_bytes) {
+            ssize_t n = ::write(fd, bgr + done, frame_bytes - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                perror("写入编码管道失败");
+                return false;
+            }
+            done += size_t(n);
+        }
+        return true;
+    }
+
+    // 结束输入并等待编码完成；ffmpeg 非 0 退出（编码或写盘失败）时返回 false
+    bool close() {
+        if (pid < 0) return true;
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        int st = 0;
+        while (waitpid(pid, &st, 0) < 0 && errno == EINTR) {}
+        pid = -1;
+        if (WIFEXITED(st) && WEXITSTATUS(st) == 0) return true;
+        if (WIFEXITED(st)) fprintf(stderr, "ffmpeg 异常退出（退出码 %d）\n", WEXITSTATUS(st));
+        else fprintf(stderr, "ffmpeg 被信号 %d 终止\n", WIFSIGNALED(st) ? WTERMSIG(st) : 0);
+        return false;
+    }
+
+private:
+    pid_t pid = -1;
+    int fd = -1;
+    size_t frame_bytes = 0;
+};
@@ -0,0 +1,181 @@
+#pragma once
+
+// 录制归档的只读访问：
+//  - .mjc 容器：整个文件 mmap，帧数据直接指向映射区，不拷贝
+//  - JPEG 目录（例如旧版 captured_frames/）：打开时扫描一次建立索引（按文件名排序，
+//    时间戳取文件修改时间），读取时逐个 mmap
+// 多个线程可同时调用 frame()。
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <strings.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mjpeg_container.h"
+
+// 一帧的只读视图；目录模式下持有该文件的映射，析构时解除
+class FrameView {
+public:
+    FrameView() {}
+    FrameView(const uint8_t* d, size_t n, uint32_t seq, uint64_t ts, void* map = nullptr, size_t map_len = 0)
+        : data(d), size(n), sequence(seq), timestamp_ns(ts), mapping(map), mapping_len(map_len) {}
+    FrameView(FrameView&& o) noexcept { *this = std::move(o); }
+    FrameView& operator=(FrameView&& o) noexcept {
+        std::swap(data, o.data);
+        std::swap(size, o.size);
+        std::swap(sequence, o.sequence);
+        std::swap(timestamp_ns, o.timestamp_ns);
+        std::swap(mapping, o.mapping);
+        std::swap(mapping_len, o.mapping_len);
+        return *this;
+    }
+    FrameView(const FrameView&) = delete;
+    FrameView& operator=(const FrameView&) = delete;
+    ~FrameView() {
+        if (mapping) munmap(mapping, mapping_len);
+    }
+
+    bool valid() const { return data != nullptr; }
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    uint32_t sequence = 0;
+    uint64_t timestamp_ns = 0;
+
+private:
+    void* mapping = nullptr;
+    size_t mapping_len = 0;
+};
+
+class FrameArchive {
+public:
+    ~FrameArchive() {
+        if (map) munmap(map, map_len);
+    }
+
+    bool open(const char* path) {
+        struct stat st;
+        if (stat(path, &st) < 0) {
+            perror(path);
+            return false;
+        }
+        return S_ISDIR(st.st_mode) ? open_dir(path) : open_mjc(path);
+    }
+
+    size_t frame_count() const { return entries.size(); }
+    bool is_container() const { return map != nullptr; }
+
+    uint64_t timestamp_ns(size_t i) const { return entries[i].timestamp_ns; }
+    uint32_t sequence(size_t i) const { return entries[i].sequence; }
+
+    // 录制时长（秒），用于计算处理速度相对实时的倍数
+    double duration_sec() const {
+        if (entries.size() < 2) return 0;
+        return (entries.back().timestamp_ns - entries.front().timestamp_ns) / 1e9;
+    }
+
+    FrameView frame(size_t i) const {
+        const Entry& e = entries[i];
+        if (map)
+            return FrameView(static_cast<const uint8_t*>(map) + e.offset, e.size, e.sequence, e.timestamp_ns);
+
+        int fd = ::open(files[i].c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return FrameView();
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+            p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return FrameView();
+        return FrameView(static_cast<const uint8_t*>(p), st.st_size, e.sequence, e.timestamp_ns, p, st.st_size);
+    }
+
+private:
+    struct Entry {
+        uint64_t offset;      // 容器：JPEG 数据在文件中的偏移
+        size_t size;
+        uint32_t sequence;
+        uint64_t timestamp_ns;
+    };
+
+    bool open_mjc(const char* path) {
+        // 索引（含异常结束文件的恢复扫描）沿用 MjcReader 的逻辑
+        MjcReader reader;
+        if (!reader.open(path)) return false;
+        if (reader.recovered) fprintf(stderr, "%s 录制未正常结束，使用恢复的索引\n", path);
+
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0) {
+            perror(path);
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+        map_len = st.st_size;
+        map = mmap(nullptr, map_len, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            perror("mmap 录制文件失败");
+            map = nullptr;
+            return false;
+        }
+        // 按顺序处理，提示内核提前读入
+        madvise(map, map_len, MADV_SEQUENTIAL);
+
+        // 索引项来自文件本身，超出映射范围的（文件损坏或被截断）丢弃，否则访问时会 SIGBUS
+        entries.reserve(reader.frame_count());
+        size_t dropped = 0;
+        for (size_t i = 0; i < reader.frame_count(); ++i) {
+            const MjcIndexEntry& e = reader.entry(i);
+            if (e.offset > map_len || map_len - e.offset < sizeof(MjcRecordHeader) + uint64_t(e.size)) {
+                dropped++;
+                continue;
+            }
+            entries.push_back({e.offset + sizeof(MjcRecordHeader), e.size, e.sequence, e.timestamp_ns});
+        }
+        if (dropped) fprintf(stderr, "%s 有 %zu 个索引项超出文件范围，已跳过\n", path, dropped);
+        return true;
+    }
+
+    bool open_dir(const char* path) {
+        DIR* dir = opendir(path);
+        if (!dir) {
+            perror(path);
+            return false;
+        }
+        std::vector<std::string> names;
+        while (dirent* d = readdir(dir)) {
+            const char* ext = strrchr(d->d_name, '.');
+            if (ext && (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0))
+                names.push_back(d->d_name);
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+
+        for (size_t i = 0; i < names.size(); ++i) {
+            std::string full = std::string(path) + "/" + names[i];
+            struct stat st;
+            if (stat(full.c_str(), &st) < 0) continue;
+            uint64_t ts = uint64_t(st.st_mtim.tv_sec) * 1000000000ull + st.st_mtim.tv_nsec;
+            // 文件名中的数字作为帧序号（frame_0123.jpg），没有时用排序后的位置
+            const char* digits = names[i].c_str() + strcspn(names[i].c_str(), "0123456789");
+            uint32_t seq = *digits ? uint32_t(strtoul(digits, nullptr, 10)) : uint32_t(i);
+            entries.push_back({0, size_t(st.st_size), seq, ts});
+            files.push_back(full);
+        }
+        return true;
+    }
+
+    void* map = nullptr;
+    size_t map_len = 0;
+    std::vector<Entry> entries;
+    std::vector<std::string> files;   // 目录模式下每帧的文件路径
+};
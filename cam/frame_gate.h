@@ -0,0 +1,70 @@
+#pragma once
+
+// 帧差门限：静止画面下只保存发生变化的帧。
+// 每帧以 1/8 分辨率解码灰度（libjpeg 只做 DC/低频，几毫秒），再缩小到约 100x75，
+// 与最近保存的关键帧逐像素比较，平均绝对差（0~255）低于阈值则丢弃。
+// 距上一个关键帧超过 keyframe_interval 时强制保存一帧，保证时间线上有足够的参考帧。
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#define GATE_THUMB_WIDTH 102   // 3264 / 32
+
+class FrameGate {
+public:
+    FrameGate(double min_score, double keyframe_interval_sec)
+        : threshold(min_score), keyframe_interval_ns(uint64_t(keyframe_interval_sec * 1e9)) {}
+
+    // 返回 true 表示应保存该帧，此时它成为新的关键帧；score 为与关键帧的差异
+    bool should_store(const uint8_t* jpeg, size_t size, uint64_t timestamp_ns, double* score) {
+        auto t0 = std::chrono::steady_clock::now();
+        *score = 0;
+        bool store = true;
+
+        cv::Mat encoded(1, int(size), CV_8UC1, const_cast<uint8_t*>(jpeg));
+        cv::Mat small = cv::imdecode(encoded, cv::IMREAD_REDUCED_GRAYSCALE_8);
+        if (small.empty()) {
+            decode_failures++;   // 无法解码时保守处理：照常保存
+        } else {
+            int h = small.rows * GATE_THUMB_WIDTH / small.cols;
+            cv::resize(small, thumb, cv::Size(GATE_THUMB_WIDTH, h > 0 ? h : 1), 0, 0, cv::INTER_AREA);
+            if (!key.empty() && key.size() == thumb.size()) {
+                cv::absdiff(thumb, key, diff);
+                *score = cv::mean(diff)[0];
+                store = *score >= threshold || timestamp_ns - key_ts >= keyframe_interval_ns;
+            }
+            if (store) {
+                std::swap(key, thumb);
+                key_ts = timestamp_ns;
+            }
+        }
+
+        (store ? stored : skipped)++;
+        gate_sec += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return store;
+    }
+
+    void print_summary() const {
+        uint64_t total = stored + skipped;
+        printf("帧差门限 %.2f，关键帧间隔 %.1f 秒: 保存 %llu 帧，跳过 %llu 帧（%.1f%%），"
+               "每帧判断 %.2f ms，解码失败 %d\n",
+               threshold, keyframe_interval_ns / 1e9, (unsigned long long)stored,
+               (unsigned long long)skipped, total ? 100.0 * skipped / total : 0.0,
+               total ? gate_sec / total * 1000 : 0.0, decode_failures);
+    }
+
+private:
+    double threshold;
+    uint64_t keyframe_interval_ns;
+    cv::Mat key;      // 最近一个关键帧的缩略图
+    cv::Mat thumb;
+    cv::Mat diff;
+    uint64_t key_ts = 0;
+
+    uint64_t stored = 0;
+    uint64_t skipped = 0;
+    int decode_failures = 0;
+    double gate_sec = 0;
+};
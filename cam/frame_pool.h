@@ -0,0 +1,136 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 预分配帧缓冲池
+// 采集线程取空闲缓冲 -> 填充 -> 提交；写盘线程取出 -> 处理 -> 归还。
+// 所有缓冲在初始化时一次性分配并循环使用，运行期间内存占用恒定。
+
+struct pool_frame {
+    uint8_t *data;
+    size_t size;                // 有效数据长度
+    size_t capacity;            // 缓冲区容量
+    uint32_t sequence;          // V4L2 帧序号
+    struct timespec timestamp;
+};
+
+struct frame_pool {
+    struct pool_frame *frames;
+    int count;
+
+    int *free_stack;            // 空闲缓冲下标（栈）
+    int free_top;
+
+    int *ready_ring;            // 待处理缓冲下标（FIFO）
+    int ready_head;
+    int ready_len;
+
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t free_cond;
+    pthread_cond_t ready_cond;
+};
+
+static inline void frame_pool_destroy(struct frame_pool *pool) {
+    if (pool->frames) {
+        for (int i = 0; i < pool->count; i++)
+            free(pool->frames[i].data);
+    }
+    free(pool->frames);
+    free(pool->free_stack);
+    free(pool->ready_ring);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->free_cond);
+    pthread_cond_destroy(&pool->ready_cond);
+    memset(pool, 0, sizeof(*pool));
+}
+
+// 分配 count 个容量为 capacity 的缓冲（按页对齐），成功返回 0
+static inline int frame_pool_init(struct frame_pool *pool, int count, size_t capacity) {
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->free_cond, NULL);
+    pthread_cond_init(&pool->ready_cond, NULL);
+
+    pool->count = count;
+    pool->frames = calloc(count, sizeof(*pool->frames));
+    pool->free_stack = calloc(count, sizeof(int));
+    pool->ready_ring = calloc(count, sizeof(int));
+    if (!pool->frames || !pool->free_stack || !pool->ready_ring) {
+        frame_pool_destroy(pool);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        void *p = NULL;
+        if (posix_memalign(&p, 4096, capacity) != 0) {
+            frame_pool_destroy(pool);
+            return -1;
+        }
+        pool->frames[i].data = p;
+        pool->frames[i].capacity = capacity;
+        pool->free_stack[pool->free_top++] = i;
+    }
+    return 0;
+}
+
+// 取一个空闲缓冲；block 为 0 时若无空闲缓冲立即返回 NULL（由调用方计为丢帧）
+static inline struct pool_frame *frame_pool_acquire(struct frame_pool *pool, int block) {
+    struct pool_frame *f = NULL;
+    pthread_mutex_lock(&pool->lock);
+    while (block && pool->free_top == 0 && !pool->closed)
+        pthread_cond_wait(&pool->free_cond, &pool->lock);
+    if (pool->free_top > 0)
+        f = &pool->frames[pool->free_stack[--pool->free_top]];
+    pthread_mutex_unlock(&pool->lock);
+    return f;
+}
+
+// 把已填充的缓冲交给消费者
+static inline void frame_pool_submit(struct frame_pool *pool, struct pool_frame *f) {
+    pthread_mutex_lock(&pool->lock);
+    int tail = (pool->ready_head + pool->ready_len) % pool->count;
+    pool->ready_ring[tail] = (int)(f - pool->frames);
+    pool->ready_len++;
+    pthread_cond_signal(&pool->ready_cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// 取下一个待处理缓冲；池已关闭且队列为空时返回 NULL
+static inline struct pool_frame *frame_pool_next(struct frame_pool *pool) {
+    struct pool_frame *f = NULL;
+    pthread_mutex_lock(&pool->lock);
+    while (pool->ready_len == 0 && !pool->closed)
+        pthread_cond_wait(&pool->ready_cond, &pool->lock);
+    if (pool->ready_len > 0) {
+        f = &pool->frames[pool->ready_ring[pool->ready_head]];
+        pool->ready_head = (pool->ready_head + 1) % pool->count;
+        pool->ready_len--;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return f;
+}
+
+// 消费者处理完后归还缓冲
+static inline void frame_pool_release(struct frame_pool *pool, struct pool_frame *f) {
+    pthread_mutex_lock(&pool->lock);
+    pool->free_stack[pool->free_top++] = (int)(f - pool->frames);
+    pthread_cond_signal(&pool->free_cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// 采集结束：唤醒所有等待者，消费者处理完剩余缓冲后退出
+static inline void frame_pool_close(struct frame_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->closed = 1;
+    pthread_cond_broadcast(&pool->ready_cond);
+    pthread_cond_broadcast(&pool->free_cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+#endif
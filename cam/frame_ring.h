@@ -0,0 +1,104 @@
+#pragma once
+
+// 固定内存的压缩帧环形缓冲，用于触发录制的预录（pre-roll）。
+// 帧数据连续存放在一块预分配的内存中，空间或条目不足时淘汰最旧的帧，
+// 运行多久内存占用都不变。只在保存线程中使用，不加锁。
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+class FrameRing {
+public:
+    struct Entry {
+        size_t offset;
+        size_t size;
+        uint32_t sequence;
+        uint64_t timestamp_ns;
+    };
+
+    ~FrameRing() { free(arena); }
+
+    bool init(size_t bytes, size_t max_frames) {
+        if (posix_memalign(reinterpret_cast<void**>(&arena), 4096, bytes) != 0) {
+            arena = nullptr;
+            return false;
+        }
+        capacity = bytes;
+        entries.resize(max_frames);
+        clear();
+        return true;
+    }
+
+    // 存入一帧，必要时淘汰最旧的帧；单帧超过整个缓冲时返回 false
+    bool push(const void* data, size_t size, uint32_t sequence, uint64_t timestamp_ns) {
+        if (size > capacity || entries.empty()) return false;
+        if (n == entries.size()) pop_oldest();
+
+        size_t pos;
+        for (;;) {
+            if (n == 0) {
+                pos = 0;
+                break;
+            }
+            size_t oldest = entries[head].offset;
+            if (oldest < tail) {
+                // 有效数据未回绕：[oldest, tail)，尾部放不下时回到开头
+                if (tail + size <= capacity) { pos = tail; break; }
+                if (size <= oldest) { pos = 0; break; }
+            } else if (tail + size <= oldest) {
+                // 已回绕：空闲区只有 [tail, oldest)
+                pos = tail;
+                break;
+            }
+            pop_oldest();
+        }
+
+        memcpy(arena + pos, data, size);
+        entries[(head + n) % entries.size()] = {pos, size, sequence, timestamp_ns};
+        n++;
+        tail = pos + size;
+        bytes_used += size;
+        return true;
+    }
+
+    // 淘汰时间戳早于 timestamp_ns 的帧
+    void trim_before(uint64_t timestamp_ns) {
+        while (n > 0 && entries[head].timestamp_ns < timestamp_ns) pop_oldest();
+    }
+
+    void clear() {
+        head = 0;
+        n = 0;
+        tail = 0;
+        bytes_used = 0;
+    }
+
+    size_t count() const { return n; }
+    // i = 0 为最旧的帧
+    const Entry& at(size_t i) const { return entries[(head + i) % entries.size()]; }
+    const uint8_t* data(const Entry& e) const { return arena + e.offset; }
+    size_t used() const { return bytes_used; }
+    size_t size_bytes() const { return capacity; }
+    double span_sec() const { return n > 1 ? (at(n - 1).timestamp_ns - at(0).timestamp_ns) / 1e9 : 0.0; }
+
+    uint64_t evicted = 0;   // 因空间不足或超出预录时长被淘汰的帧数
+
+private:
+    void pop_oldest() {
+        bytes_used -= entries[head].size;
+        head = (head + 1) % entries.size();
+        n--;
+        evicted++;
+        if (n == 0) tail = 0;
+    }
+
+    uint8_t* arena = nullptr;
+    size_t capacity = 0;
+    std::vector<Entry> entries;
+    size_t head = 0;
+    size_t n = 0;
+    size_t tail = 0;        // 最新一帧之后的位置
+    size_t bytes_used = 0;
+};
@@ -0,0 +1,334 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// 全帧统计：每通道 min/max/mean、过曝/欠曝像素数，可选 256 级直方图。
+// step > 1 时按 step x step 网格降采样（行、列各隔 step 取一个）。
+// min/max/sum/截断计数在 NEON 上向量化（step 为 1 或 2 时；step 2 整块加载后用 uzp 取偶数像素），
+// 直方图按需单独统计（分表累加）。
+
+#define STATS_CLIP_LOW  0     // <= 该值计为欠曝
+#define STATS_CLIP_HIGH 255   // >= 该值计为过曝
+
+struct channel_stats {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t clipped_low;
+    uint64_t clipped_high;
+    uint8_t min;
+    uint8_t max;
+    double mean;
+};
+
+struct frame_stats {
+    struct channel_stats ch[3];   // YUYV: Y/U/V，RGB24: R/G/B
+    uint32_t hist[3][256];        // 仅 has_hist 时有效
+    int step;
+    int has_hist;
+};
+
+static inline void frame_stats_reset(struct frame_stats *st, int step, int with_hist) {
+    memset(st->ch, 0, sizeof(st->ch));
+    for (int c = 0; c < 3; c++)
+        st->ch[c].min = 255;
+    if (with_hist)
+        memset(st->hist, 0, sizeof(st->hist));
+    st->step = step < 1 ? 1 : step;
+    st->has_hist = with_hist;
+}
+
+static inline void stats_add(struct channel_stats *c, uint8_t v) {
+    c->count++;
+    c->sum += v;
+    if (v < c->min) c->min = v;
+    if (v > c->max) c->max = v;
+    if (v <= STATS_CLIP_LOW) c->clipped_low++;
+    if (v >= STATS_CLIP_HIGH) c->clipped_high++;
+}
+
+#if defined(__ARM_NEON)
+// 单通道 NEON 累加器：sum16/low8/high8 是窄位宽的中间累加，
+// 每 STATS_NEON_BLOCK 次必须 flush 一次以免溢出
+#define STATS_NEON_BLOCK 64
+
+struct neon_acc {
+    uint8x16_t vmin, vmax;
+    uint16x8_t sum16;
+    uint8x16_t low8, high8;
+    uint32x4_t sum32;
+    uint32x4_t low32, high32;
+};
+
+static inline void neon_acc_init(struct neon_acc *a) {
+    a->vmin = vdupq_n_u8(255);
+    a->vmax = vdupq_n_u8(0);
+    a->sum16 = vdupq_n_u16(0);
+    a->low8 = a->high8 = vdupq_n_u8(0);
+    a->sum32 = a->low32 = a->high32 = vdupq_n_u32(0);
+}
+
+static inline void neon_acc_add(struct neon_acc *a, uint8x16_t v) {
+    a->vmin = vminq_u8(a->vmin, v);
+    a->vmax = vmaxq_u8(a->vmax, v);
+    a->sum16 = vpadalq_u8(a->sum16, v);
+    // 比较结果为 0xFF，减去即计数 +1
+    a->low8 = vsubq_u8(a->low8, vcleq_u8(v, vdupq_n_u8(STATS_CLIP_LOW)));
+    a->high8 = vsubq_u8(a->high8, vcgeq_u8(v, vdupq_n_u8(STATS_CLIP_HIGH)));
+}
+
+static inline void neon_acc_flush(struct neon_acc *a) {
+    a->sum32 = vpadalq_u16(a->sum32, a->sum16);
+    a->low32 = vpadalq_u16(a->low32, vpaddlq_u8(a->low8));
+    a->high32 = vpadalq_u16(a->high32, vpaddlq_u8(a->high8));
+    a->sum16 = vdupq_n_u16(0);
+    a->low8 = a->high8 = vdupq_n_u8(0);
+}
+
+// 每行结束时并入 64 位标量结果，避免 32 位累加在大帧上溢出
+static inline void neon_acc_store(struct neon_acc *a, struct channel_stats *c) {
+    neon_acc_flush(a);
+    uint8_t mn = vminvq_u8(a->vmin), mx = vmaxvq_u8(a->vmax);
+    if (mn < c->min) c->min = mn;
+    if (mx > c->max) c->max = mx;
+    c->sum += vaddvq_u32(a->sum32);
+    c->clipped_low += vaddvq_u32(a->low32);
+    c->clipped_high += vaddvq_u32(a->high32);
+    a->sum32 = a->low32 = a->high32 = vdupq_n_u32(0);
+}
+#endif
+
+// 一行 YUYV 的直方图，Y0/Y1 分表累加以减少相邻像素写同一 bin 的依赖
+static inline void stats_hist_row_yuyv(const uint8_t *p, int pairs, int xstep,
+                                       uint32_t hy0[256], uint32_t hy1[256],
+                                       uint32_t hu[256], uint32_t hv[256]) {
+    for (int x = 0; x < pairs; x += xstep, p += 4 * xstep) {
+        hy0[p[0]]++;
+        hu[p[1]]++;
+        hy1[p[2]]++;
+        hv[p[3]]++;
+    }
+}
+
+static inline void frame_stats_finish(struct frame_stats *st) {
+    for (int c = 0; c < 3; c++) {
+        struct channel_stats *ch = &st->ch[c];
+        ch->mean = ch->count ? (double)ch->sum / ch->count : 0.0;
+        if (!ch->count) ch->min = 0;
+    }
+}
+
+// YUYV422 全帧统计；size 为实际数据长度，不完整帧只统计已有的行
+static inline void frame_stats_yuyv(const uint8_t *data, size_t size, int width, int height,
+                                    int step, int with_hist, struct frame_stats *st) {
+    frame_stats_reset(st, step, with_hist);
+    step = st->step;
+
+    const int pairs = width / 2;
+    const size_t stride = (size_t)width * 2;
+    uint32_t hy0[256], hy1[256];
+    if (with_hist) {
+        memset(hy0, 0, sizeof(hy0));
+        memset(hy1, 0, sizeof(hy1));
+    }
+
+#if defined(__ARM_NEON)
+    struct neon_acc ay, au, av;
+    neon_acc_init(&ay);
+    neon_acc_init(&au);
+    neon_acc_init(&av);
+#endif
+
+    for (int y = 0; y < height; y += step) {
+        const uint8_t *row = data + (size_t)y * stride;
+        if ((size_t)y * stride + stride > size) break;
+
+        int x = 0;
+#if defined(__ARM_NEON)
+        if (step == 1) {
+            int blocks = 0;
+            for (; x + 16 <= pairs; x += 16) {
+                uint8x16x4_t v = vld4q_u8(row + x * 4);   // Y0 U Y1 V
+                neon_acc_add(&ay, v.val[0]);
+                neon_acc_add(&ay, v.val[2]);
+                neon_acc_add(&au, v.val[1]);
+                neon_acc_add(&av, v.val[3]);
+                // Y 每次迭代累加两次，按一半的间隔 flush
+                if (++blocks == STATS_NEON_BLOCK / 2) {
+                    neon_acc_flush(&ay);
+                    neon_acc_flush(&au);
+                    neon_acc_flush(&av);
+                    blocks = 0;
+                }
+            }
+            neon_acc_store(&ay, &st->ch[0]);
+            neon_acc_store(&au, &st->ch[1]);
+            neon_acc_store(&av, &st->ch[2]);
+            st->ch[0].count += (uint64_t)x * 2;
+            st->ch[1].count += x;
+            st->ch[2].count += x;
+        } else if (step == 2) {
+            // 一次读 32 对，偶数对的 Y0/U/Y1/V 各 16 个
+            int blocks = 0;
+            for (; x + 32 <= pairs; x += 32) {
+                uint8x16x4_t a = vld4q_u8(row + x * 4);
+                uint8x16x4_t b = vld4q_u8(row + x * 4 + 64);
+                neon_acc_add(&ay, vuzp1q_u8(a.val[0], b.val[0]));
+                neon_acc_add(&ay, vuzp1q_u8(a.val[2], b.val[2]));
+                neon_acc_add(&au, vuzp1q_u8(a.val[1], b.val[1]));
+                neon_acc_add(&av, vuzp1q_u8(a.val[3], b.val[3]));
+                if (++blocks == STATS_NEON_BLOCK / 2) {
+                    neon_acc_flush(&ay);
+                    neon_acc_flush(&au);
+                    neon_acc_flush(&av);
+                    blocks = 0;
+                }
+            }
+            neon_acc_store(&ay, &st->ch[0]);
+            neon_acc_store(&au, &st->ch[1]);
+            neon_acc_store(&av, &st->ch[2]);
+            st->ch[0].count += x;
+            st->ch[1].count += x / 2;
+            st->ch[2].count += x / 2;
+        }
+#endif
+        for (; x < pairs; x += step) {
+            const uint8_t *p = row + x * 4;
+            stats_add(&st->ch[0], p[0]);
+            stats_add(&st->ch[0], p[2]);
+            stats_add(&st->ch[1], p[1]);
+            stats_add(&st->ch[2], p[3]);
+        }
+
+        if (with_hist)
+            stats_hist_row_yuyv(row, pairs, step, hy0, hy1, st->hist[1], st->hist[2]);
+    }
+
+    if (with_hist) {
+        for (int i = 0; i < 256; i++)
+            st->hist[0][i] = hy0[i] + hy1[i];
+    }
+    frame_stats_finish(st);
+}
+
+// RGB24 全帧统计
+static inline void frame_stats_rgb24(const uint8_t *data, size_t size, int width, int height,
+                                     int step, int with_hist, struct frame_stats *st) {
+    frame_stats_reset(st, step, with_hist);
+    step = st->step;
+
+    const size_t stride = (size_t)width * 3;
+
+#if defined(__ARM_NEON)
+    struct neon_acc ar, ag, ab;
+    neon_acc_init(&ar);
+    neon_acc_init(&ag);
+    neon_acc_init(&ab);
+#endif
+
+    for (int y = 0; y < height; y += step) {
+        const uint8_t *row = data + (size_t)y * stride;
+        if ((size_t)y * stride + stride > size) break;
+
+        int x = 0;
+#if defined(__ARM_NEON)
+        if (step == 1) {
+            int blocks = 0;
+            for (; x + 16 <= width; x += 16) {
+                uint8x16x3_t v = vld3q_u8(row + x * 3);   // R G B
+                neon_acc_add(&ar, v.val[0]);
+                neon_acc_add(&ag, v.val[1]);
+                neon_acc_add(&ab, v.val[2]);
+                if (++blocks == STATS_NEON_BLOCK) {
+                    neon_acc_flush(&ar);
+                    neon_acc_flush(&ag);
+                    neon_acc_flush(&ab);
+                    blocks = 0;
+                }
+            }
+            neon_acc_store(&ar, &st->ch[0]);
+            neon_acc_store(&ag, &st->ch[1]);
+            neon_acc_store(&ab, &st->ch[2]);
+            for (int c = 0; c < 3; c++)
+                st->ch[c].count += x;
+        } else if (step == 2) {
+            // 一次读 32 个像素，取偶数像素各 16 个
+            int blocks = 0;
+            for (; x + 32 <= width; x += 32) {
+                uint8x16x3_t a = vld3q_u8(row + x * 3);
+                uint8x16x3_t b = vld3q_u8(row + x * 3 + 48);
+                neon_acc_add(&ar, vuzp1q_u8(a.val[0], b.val[0]));
+                neon_acc_add(&ag, vuzp1q_u8(a.val[1], b.val[1]));
+                neon_acc_add(&ab, vuzp1q_u8(a.val[2], b.val[2]));
+                if (++blocks == STATS_NEON_BLOCK) {
+                    neon_acc_flush(&ar);
+                    neon_acc_flush(&ag);
+                    neon_acc_flush(&ab);
+                    blocks = 0;
+                }
+            }
+            neon_acc_store(&ar, &st->ch[0]);
+            neon_acc_store(&ag, &st->ch[1]);
+            neon_acc_store(&ab, &st->ch[2]);
+            for (int c = 0; c < 3; c++)
+                st->ch[c].count += x / 2;
+        }
+#endif
+        for (; x < width; x += step) {
+            const uint8_t *p = row + x * 3;
+            stats_add(&st->ch[0], p[0]);
+            stats_add(&st->ch[1], p[1]);
+            stats_add(&st->ch[2], p[2]);
+        }
+
+        if (with_hist) {
+            const uint8_t *p = row;
+            for (int i = 0; i < width; i += step, p += 3 * step) {
+                st->hist[0][p[0]]++;
+                st->hist[1][p[1]]++;
+                st->hist[2][p[2]]++;
+            }
+        }
+    }
+
+    frame_stats_finish(st);
+}
+
+// 直方图百分位（0-100），用于自动曝光/阈值选择；无直方图时返回 -1
+static inline int frame_stats_percentile(const struct frame_stats *st, int c, double pct) {
+    if (!st->has_hist || st->ch[c].count == 0) return -1;
+    uint64_t target = (uint64_t)(st->ch[c].count * pct / 100.0);
+    uint64_t acc = 0;
+    for (int i = 0; i < 256; i++) {
+        acc += st->hist[c][i];
+        if (acc > target) return i;
+    }
+    return 255;
+}
+
+// names 为三个通道的名字，例如 "YUV" 或 "RGB"
+static inline void frame_stats_print(const struct frame_stats *st, const char *names) {
+    printf("Full frame (grid step %d):\n", st->step);
+    for (int c = 0; c < 3; c++) {
+        const struct channel_stats *ch = &st->ch[c];
+        printf("  %c: avg=%.1f, min=%d, max=%d, clipped low=%.2f%% high=%.2f%%",
+               names[c], ch->mean, ch->min, ch->max,
+               ch->count ? 100.0 * ch->clipped_low / ch->count : 0.0,
+               ch->count ? 100.0 * ch->clipped_high / ch->count : 0.0);
+        if (st->has_hist)
+            printf(", p5=%d, p50=%d, p95=%d",
+                   frame_stats_percentile(st, c, 5),
+                   frame_stats_percentile(st, c, 50),
+                   frame_stats_percentile(st, c, 95));
+        printf("\n");
+    }
+}
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#ifdef HAVE_LIBPNG
+#include <png.h>
+#endif
+
+#include "frame_pool.h"
+
+// RGB 帧无损写盘：PPM（原始）、QOI（快速无损）、PNG（需 -DHAVE_LIBPNG -lpng）。
+// image_writer 启动若干写盘线程，直接从 frame_pool 取帧编码写盘后归还，
+// 采集线程只负责填充和提交，编码与写盘在后台并行进行。
+
+enum image_format {
+    IMG_PPM,
+    IMG_QOI,
+    IMG_PNG,
+};
+
+#define IMAGE_WRITER_MAX_THREADS 8
+
+static inline const char *image_format_ext(enum image_format fmt) {
+    switch (fmt) {
+    case IMG_QOI: return "qoi";
+    case IMG_PNG: return "png";
+    default:      return "ppm";
+    }
+}
+
+// 解析 "ppm" / "qoi" / "png"，无法识别时返回 -1
+static inline int image_format_parse(const char *s) {
+    if (strcmp(s, "ppm") == 0) return IMG_PPM;
+    if (strcmp(s, "qoi") == 0) return IMG_QOI;
+    if (strcmp(s, "png") == 0) {
+#ifdef HAVE_LIBPNG
+        return IMG_PNG;
+#else
+        fprintf(stderr, "PNG support not compiled in (build with -DHAVE_LIBPNG -lpng)\n");
+        return -1;
+#endif
+    }
+    return -1;
+}
+
+// ========================= QOI 编码 =========================
+// 参考 https://qoiformat.org/qoi-specification.pdf ，3 通道 sRGB
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+#define QOI_CHUNK    (64 * 1024)  // 输出分块写入，避免整帧大小的临时缓冲
+
+static inline void qoi_put32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+// 编码 RGB24 并写入 fp，返回写入的字节数，出错返回 0
+static inline size_t qoi_write_rgb(FILE *fp, const uint8_t *rgb, int width, int height) {
+    uint8_t out[QOI_CHUNK];
+    size_t pos = 0, total = 0;
+
+    memcpy(out, "qoif", 4);
+    qoi_put32(out + 4, width);
+    qoi_put32(out + 8, height);
+    out[12] = 3;   // channels
+    out[13] = 0;   // sRGB
+    pos = 14;
+
+    uint32_t index[64];
+    memset(index, 0, sizeof(index));
+    uint8_t pr = 0, pg = 0, pb = 0;
+    int run = 0;
+    const size_t npix = (size_t)width * height;
+
+    for (size_t i = 0; i < npix; i++, rgb += 3) {
+        uint8_t r = rgb[0], g = rgb[1], b = rgb[2];
+
+        if (r == pr && g == pg && b == pb) {
+            run++;
+            if (run == 62 || i == npix - 1) {
+                out[pos++] = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+        } else {
+            if (run > 0) {
+                out[pos++] = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+
+            // alpha 恒为 255
+            uint32_t px = (uint32_t)r << 24 | (uint32_t)g << 16 | (uint32_t)b << 8 | 0xff;
+            int h = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+
+            if (index[h] == px) {
+                out[pos++] = QOI_OP_INDEX | h;
+            } else {
+                index[h] = px;
+                int8_t vr = (int8_t)(r - pr);
+                int8_t vg = (int8_t)(g - pg);
+                int8_t vb = (int8_t)(b - pb);
+                int8_t vg_r = vr - vg;
+                int8_t vg_b = vb - vg;
+
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                    out[pos++] = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                    out[pos++] = QOI_OP_LUMA | (vg + 32);
+                    out[pos++] = (vg_r + 8) << 4 | (vg_b + 8);
+                } else {
+                    out[pos++] = QOI_OP_RGB;
+                    out[pos++] = r;
+                    out[pos++] = g;
+                    out[pos++] = b;
+                }
+            }
+            pr = r;
+            pg = g;
+            pb = b;
+        }
+
+        // 单个像素最多 4 字节，加上结尾 8 字节
+        if (pos > QOI_CHUNK - 16) {
+            if (fwrite(out, 1, pos, fp) != pos) return 0;
+            total += pos;
+            pos = 0;
+        }
+    }
+
+    static const uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    memcpy(out + pos, padding, sizeof(padding));
+    pos += sizeof(padding);
+    if (fwrite(out, 1, pos, fp) != pos) return 0;
+    return total + pos;
+}
+
+#ifdef HAVE_LIBPNG
+// 低压缩级别 + SUB 滤波，优先速度
+static inline size_t png_write_rgb(FILE *fp, const uint8_t *rgb, int width, int height) {
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    if (!png || !info) {
+        png_destroy_write_struct(&png, &info);
+        return 0;
+    }
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        return 0;
+    }
+
+    png_init_io(png, fp);
+    png_set_compression_level(png, 1);
+    png_set_filter(png, 0, PNG_FILTER_SUB);
+    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for (int y = 0; y < height; y++)
+        png_write_row(png, (png_const_bytep)(rgb + (size_t)y * width * 3));
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+
+    long end = ftell(fp);
+    return end > 0 ? (size_t)end : 0;
+}
+#endif
+
+// 按格式写一帧 RGB24，返回文件字节数，失败返回 0
+static inline size_t write_rgb_image(const char *filename, enum image_format fmt,
+                                     const uint8_t *rgb, int width, int height) {
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) {
+        perror("Cannot open image file");
+        return 0;
+    }
+
+    size_t written = 0;
+    switch (fmt) {
+    case IMG_QOI:
+        written = qoi_write_rgb(fp, rgb, width, height);
+        break;
+#ifdef HAVE_LIBPNG
+    case IMG_PNG:
+        written = png_write_rgb(fp, rgb, width, height);
+        break;
+#endif
+    default: {
+        int header = fprintf(fp, "P6\n%d %d\n255\n", width, height);
+        size_t data = (size_t)width * height * 3;
+        if (header > 0 && fwrite(rgb, 1, data, fp) == data)
+            written = header + data;
+        break;
+    }
+    }
+
+    if (fclose(fp) != 0 || written == 0) {
+        perror("Error writing image data");
+        return 0;
+    }
+    return written;
+}
+
+// ========================= 后台写盘线程池 =========================
+struct image_writer {
+    struct frame_pool *pool;
+    enum image_format format;
+    int width;
+    int height;
+    const char *prefix;         // 文件名前缀，例如 "frame"
+
+    int n_threads;
+    pthread_t threads[IMAGE_WRITER_MAX_THREADS];
+
+    pthread_mutex_t stats_lock;
+    int frames_written;
+    int frames_failed;
+    uint64_t raw_bytes;
+    uint64_t out_bytes;
+    double busy_time;           // 所有线程编码+写盘耗时之和
+    struct timespec start_time;
+    struct timespec end_time;
+};
+
+static inline double writer_elapsed(const struct timespec *a, const struct timespec *b) {
+    return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+static inline void *image_writer_thread(void *arg) {
+    struct image_writer *w = arg;
+    struct pool_frame *f;
+
+    while ((f = frame_pool_next(w->pool)) != NULL) {
+        char filename[128];
+        snprintf(filename, sizeof(filename), "%s_%06u.%s",
+                 w->prefix, f->sequence, image_format_ext(w->format));
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        // 不完整的帧按失败计，不编码缓冲里残留的旧数据
+        size_t written = 0;
+        if (f->size >= (size_t)w->width * w->height * 3)
+            written = write_rgb_image(filename, w->format, f->data, w->width, w->height);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        size_t raw = f->size;
+        frame_pool_release(w->pool, f);
+
+        pthread_mutex_lock(&w->stats_lock);
+        if (written) {
+            w->frames_written++;
+            w->raw_bytes += raw;
+            w->out_bytes += written;
+        } else {
+            w->frames_failed++;
+        }
+        w->busy_time += writer_elapsed(&t0, &t1);
+        pthread_mutex_unlock(&w->stats_lock);
+    }
+    return NULL;
+}
+
+// 启动写盘线程；调用方随后向 pool 提交帧，结束时 frame_pool_close 再 image_writer_join
+static inline int image_writer_start(struct image_writer *w, struct frame_pool *pool,
+                                     enum image_format fmt, int width, int height,
+                                     const char *prefix, int n_threads) {
+    memset(w, 0, sizeof(*w));
+    w->pool = pool;
+    w->format = fmt;
+    w->width = width;
+    w->height = height;
+    w->prefix = prefix;
+    if (n_threads < 1) n_threads = 1;
+    if (n_threads > IMAGE_WRITER_MAX_THREADS) n_threads = IMAGE_WRITER_MAX_THREADS;
+    pthread_mutex_init(&w->stats_lock, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &w->start_time);
+
+    for (int i = 0; i < n_threads; i++) {
+        if (pthread_create(&w->threads[i], NULL, image_writer_thread, w) != 0)
+            break;
+        w->n_threads++;
+    }
+    return w->n_threads > 0 ? 0 : -1;
+}
+
+static inline void image_writer_join(struct image_writer *w) {
+    for (int i = 0; i < w->n_threads; i++)
+        pthread_join(w->threads[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &w->end_time);
+    pthread_mutex_destroy(&w->stats_lock);
+}
+
+static inline void image_writer_print_summary(const struct image_writer *w) {
+    double wall = writer_elapsed(&w->start_time, &w->end_time);
+    double raw_mb = w->raw_bytes / (1024.0 * 1024.0);
+    double out_mb = w->out_bytes / (1024.0 * 1024.0);
+
+    printf("Writer summary (%s, %d threads):\n", image_format_ext(w->format), w->n_threads);
+    printf("  Frames written: %d, failed: %d\n", w->frames_written, w->frames_failed);
+    printf("  Raw %.1f MB -> %.1f MB on disk (ratio %.2f:1)\n",
+           raw_mb, out_mb, out_mb > 0 ? raw_mb / out_mb : 0.0);
+    if (wall > 0 && w->busy_time > 0)
+        printf("  Throughput: %.1f MB/s raw, %.1f MB/s written, %.1f MB/s per thread\n",
+               raw_mb / wall, out_mb / wall, raw_mb / w->busy_time);
+}
+
+#endif
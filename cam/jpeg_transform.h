@@ -0,0 +1,285 @@
+#pragma once
+
+// JPEG 无损裁剪/旋转/翻转（jpegtran 式 DCT 域变换），编译需 -ljpeg。
+// 只读出量化后的 DCT 系数，按块重新排列（翻转时对奇数频率取反，转置时转置系数和量化表），
+// 再直接熵编码写出，不做 IDCT/颜色转换/重新量化：画质不变，也比解码、裁剪、重新编码快得多。
+// 裁剪起点按 MCU（4:2:0 为 16x16）向下对齐；旋转/翻转时裁掉右侧和底部不足一个 MCU 的边缘
+// （同 jpegtran -trim）。optimize 时重新生成最优 Huffman 表，输出再小约 1%，但熵编码要多扫一遍。
+// 每个线程使用各自的 JpegTransformer，结构和缓冲在帧之间复用。
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <setjmp.h>
+#include <vector>
+#include <jpeglib.h>
+
+enum class JpegOp { None, FlipH, FlipV, Rot90, Rot180, Rot270, Transpose, Transverse };
+
+struct JpegTransform {
+    JpegOp op = JpegOp::None;
+    int crop_x = 0;         // 裁剪区域（原图坐标），crop_w/crop_h 为 0 表示不裁剪
+    int crop_y = 0;
+    int crop_w = 0;
+    int crop_h = 0;
+    bool optimize = false;  // 重新生成最优 Huffman 表
+};
+
+// 解析命令行写法：hflip vflip rot90 rot180 rot270 transpose transverse none
+static inline bool parse_jpeg_op(const char* s, JpegOp* op) {
+    static const struct { const char* name; JpegOp op; } names[] = {
+        {"none", JpegOp::None}, {"hflip", JpegOp::FlipH}, {"vflip", JpegOp::FlipV},
+        {"rot90", JpegOp::Rot90}, {"rot180", JpegOp::Rot180}, {"rot270", JpegOp::Rot270},
+        {"transpose", JpegOp::Transpose}, {"transverse", JpegOp::Transverse},
+    };
+    for (const auto& n : names) {
+        if (strcmp(s, n.name) == 0) {
+            *op = n.op;
+            return true;
+        }
+    }
+    return false;
+}
+
+class JpegTransformer {
+public:
+    JpegTransformer() {
+        src.err = jpeg_std_error(&err.pub);
+        err.pub.error_exit = on_error;
+        err.pub.output_message = on_message;
+        jpeg_create_decompress(&src);
+        dst.err = &err.pub;
+        jpeg_create_compress(&dst);
+        dest.pub.init_destination = init_destination;
+        dest.pub.empty_output_buffer = empty_output_buffer;
+        dest.pub.term_destination = term_destination;
+        dst.dest = &dest.pub;
+    }
+    ~JpegTransformer() {
+        jpeg_destroy_compress(&dst);
+        jpeg_destroy_decompress(&src);
+    }
+    JpegTransformer(const JpegTransformer&) = delete;
+    JpegTransformer& operator=(const JpegTransformer&) = delete;
+
+    // 变换一帧，结果写入 out（复用其容量）；失败时返回 false，error() 给出原因
+    bool apply(const uint8_t* jpeg, size_t size, const JpegTransform& t, std::vector<uint8_t>& out) {
+        dest.out = &out;
+        err.message[0] = '\0';
+        if (setjmp(err.jump)) {
+            jpeg_abort_compress(&dst);
+            jpeg_abort_decompress(&src);
+            return false;
+        }
+        if (!run(jpeg, size, t)) {
+            jpeg_abort_compress(&dst);
+            jpeg_abort_decompress(&src);
+            return false;
+        }
+        return true;
+    }
+
+    const char* error() const { return err.message; }
+    // 最近一次成功变换的输出尺寸
+    int width() const { return out_width; }
+    int height() const { return out_height; }
+
+private:
+    struct ErrorMgr {
+        jpeg_error_mgr pub;
+        jmp_buf jump;
+        char message[JMSG_LENGTH_MAX];
+    };
+
+    struct VectorDest {
+        jpeg_destination_mgr pub;
+        std::vector<uint8_t>* out;
+    };
+
+    static void on_error(j_common_ptr cinfo) {
+        ErrorMgr* e = reinterpret_cast<ErrorMgr*>(cinfo->err);
+        (*cinfo->err->format_message)(cinfo, e->message);
+        longjmp(e->jump, 1);
+    }
+    static void on_message(j_common_ptr) {}
+
+    static void init_destination(j_compress_ptr cinfo) {
+        VectorDest* d = reinterpret_cast<VectorDest*>(cinfo->dest);
+        d->out->resize(d->out->capacity() > 65536 ? d->out->capacity() : 65536);
+        d->pub.next_output_byte = d->out->data();
+        d->pub.free_in_buffer = d->out->size();
+    }
+    static boolean empty_output_buffer(j_compress_ptr cinfo) {
+        VectorDest* d = reinterpret_cast<VectorDest*>(cinfo->dest);
+        size_t used = d->out->size();
+        d->out->resize(used * 2);
+        d->pub.next_output_byte = d->out->data() + used;
+        d->pub.free_in_buffer = d->out->size() - used;
+        return TRUE;
+    }
+    static void term_destination(j_compress_ptr cinfo) {
+        VectorDest* d = reinterpret_cast<VectorDest*>(cinfo->dest);
+        d->out->resize(d->out->size() - d->pub.free_in_buffer);
+    }
+
+    static bool transposes(JpegOp op) {
+        return op == JpegOp::Rot90 || op == JpegOp::Rot270 || op == JpegOp::Transpose || op == JpegOp::Transverse;
+    }
+
+    static int div_up(int a, int b) { return (a + b - 1) / b; }
+
+    // 目标块内系数 k 取自源块的 coef_src[k]，乘以 coef_sign[k]
+    void build_coef_map(JpegOp op) {
+        bool tr = transposes(op);
+        for (int r = 0; r < DCTSIZE; ++r) {
+            for (int c = 0; c < DCTSIZE; ++c) {
+                bool neg = false;
+                switch (op) {
+                case JpegOp::FlipH: case JpegOp::Rot90: neg = c & 1; break;
+                case JpegOp::FlipV: case JpegOp::Rot270: neg = r & 1; break;
+                case JpegOp::Rot180: case JpegOp::Transverse: neg = (r + c) & 1; break;
+                default: break;
+                }
+                coef_src[r * DCTSIZE + c] = tr ? c * DCTSIZE + r : r * DCTSIZE + c;
+                coef_sign[r * DCTSIZE + c] = neg ? -1 : 1;
+            }
+        }
+    }
+
+    // 目标块 (dx, dy) 对应裁剪区内的源块，ws/hs 为裁剪区的块数
+    static void source_block(JpegOp op, int dx, int dy, int ws, int hs, int* sx, int* sy) {
+        switch (op) {
+        case JpegOp::None:       *sx = dx;          *sy = dy;          break;
+        case JpegOp::FlipH:      *sx = ws - 1 - dx; *sy = dy;          break;
+        case JpegOp::FlipV:      *sx = dx;          *sy = hs - 1 - dy; break;
+        case JpegOp::Rot180:     *sx = ws - 1 - dx; *sy = hs - 1 - dy; break;
+        case JpegOp::Transpose:  *sx = dy;          *sy = dx;          break;
+        case JpegOp::Rot90:      *sx = dy;          *sy = hs - 1 - dx; break;
+        case JpegOp::Rot270:     *sx = ws - 1 - dy; *sy = dx;          break;
+        case JpegOp::Transverse: *sx = ws - 1 - dy; *sy = hs - 1 - dx; break;
+        }
+    }
+
+    // 这里不能有需要析构的局部对象：出错时 libjpeg 通过 longjmp 直接回到 apply()
+    bool run(const uint8_t* jpeg, size_t size, const JpegTransform& t) {
+        jpeg_mem_src(&src, const_cast<uint8_t*>(jpeg), (unsigned long)size);
+        jpeg_read_header(&src, TRUE);
+
+        const int mcu_w = src.max_h_samp_factor * DCTSIZE;
+        const int mcu_h = src.max_v_samp_factor * DCTSIZE;
+        const int img_w = int(src.image_width);
+        const int img_h = int(src.image_height);
+        if (t.crop_x < 0 || t.crop_y < 0 || t.crop_w < 0 || t.crop_h < 0) {
+            snprintf(err.message, sizeof(err.message), "裁剪参数不能为负（%d,%d,%d,%d）", t.crop_x, t.crop_y,
+                     t.crop_w, t.crop_h);
+            return false;
+        }
+        int x0 = t.crop_w > 0 ? t.crop_x / mcu_w * mcu_w : 0;
+        int y0 = t.crop_h > 0 ? t.crop_y / mcu_h * mcu_h : 0;
+        int x1 = t.crop_w > 0 ? t.crop_x + t.crop_w : img_w;
+        int y1 = t.crop_h > 0 ? t.crop_y + t.crop_h : img_h;
+        if (x1 > img_w) x1 = img_w;
+        if (y1 > img_h) y1 = img_h;
+        int cw = x1 - x0;
+        int ch = y1 - y0;
+        if (t.op != JpegOp::None) {
+            cw = cw / mcu_w * mcu_w;
+            ch = ch / mcu_h * mcu_h;
+        }
+        if (cw <= 0 || ch <= 0) {
+            snprintf(err.message, sizeof(err.message), "裁剪区域超出图像（%dx%d）", img_w, img_h);
+            return false;
+        }
+
+        const bool tr = transposes(t.op);
+        out_width = tr ? ch : cw;
+        out_height = tr ? cw : ch;
+        const int dst_mcu_w = tr ? mcu_h : mcu_w;
+        const int dst_mcu_h = tr ? mcu_w : mcu_h;
+
+        // 目标系数数组必须在 jpeg_read_coefficients 之前申请
+        for (int ci = 0; ci < src.num_components; ++ci) {
+            const jpeg_component_info& comp = src.comp_info[ci];
+            int h_samp = tr ? comp.v_samp_factor : comp.h_samp_factor;
+            int v_samp = tr ? comp.h_samp_factor : comp.v_samp_factor;
+            dst_blocks_w[ci] = div_up(out_width, dst_mcu_w) * h_samp;
+            dst_blocks_h[ci] = div_up(out_height, dst_mcu_h) * v_samp;
+            dst_arrays[ci] = (*src.mem->request_virt_barray)(reinterpret_cast<j_common_ptr>(&src), JPOOL_IMAGE, FALSE,
+                                                             JDIMENSION(dst_blocks_w[ci]), JDIMENSION(dst_blocks_h[ci]),
+                                                             JDIMENSION(v_samp));
+        }
+        jvirt_barray_ptr* src_arrays = jpeg_read_coefficients(&src);
+
+        jpeg_copy_critical_parameters(&src, &dst);
+        dst.image_width = JDIMENSION(out_width);
+        dst.image_height = JDIMENSION(out_height);
+        dst.optimize_coding = t.optimize ? TRUE : FALSE;
+        if (tr) {
+            for (int ci = 0; ci < dst.num_components; ++ci) {
+                jpeg_component_info& comp = dst.comp_info[ci];
+                int h = comp.h_samp_factor;
+                comp.h_samp_factor = comp.v_samp_factor;
+                comp.v_samp_factor = h;
+            }
+            for (int q = 0; q < NUM_QUANT_TBLS; ++q) {
+                JQUANT_TBL* tbl = dst.quant_tbl_ptrs[q];
+                if (!tbl) continue;
+                for (int r = 0; r < DCTSIZE; ++r)
+                    for (int c = r + 1; c < DCTSIZE; ++c) {
+                        UINT16 v = tbl->quantval[r * DCTSIZE + c];
+                        tbl->quantval[r * DCTSIZE + c] = tbl->quantval[c * DCTSIZE + r];
+                        tbl->quantval[c * DCTSIZE + r] = v;
+                    }
+            }
+        }
+        jpeg_write_coefficients(&dst, dst_arrays);
+
+        build_coef_map(t.op);
+        for (int ci = 0; ci < src.num_components; ++ci) {
+            const jpeg_component_info& comp = src.comp_info[ci];
+            int ox = x0 / mcu_w * comp.h_samp_factor;
+            int oy = y0 / mcu_h * comp.v_samp_factor;
+            int ws = tr ? dst_blocks_h[ci] : dst_blocks_w[ci];
+            int hs = tr ? dst_blocks_w[ci] : dst_blocks_h[ci];
+
+            // 系数数组全部在内存中（libjpeg-turbo 不使用磁盘后备存储），逐行取一次指针后可随机访问
+            src_rows.resize(size_t(hs));
+            for (int y = 0; y < hs; ++y)
+                src_rows[y] = (*src.mem->access_virt_barray)(reinterpret_cast<j_common_ptr>(&src), src_arrays[ci],
+                                                             JDIMENSION(oy + y), 1, FALSE)[0] + ox;
+            for (int dy = 0; dy < dst_blocks_h[ci]; ++dy) {
+                JBLOCKROW row = (*src.mem->access_virt_barray)(reinterpret_cast<j_common_ptr>(&src), dst_arrays[ci],
+                                                               JDIMENSION(dy), 1, TRUE)[0];
+                if (t.op == JpegOp::None) {
+                    memcpy(row, src_rows[dy], sizeof(JBLOCK) * size_t(dst_blocks_w[ci]));
+                    continue;
+                }
+                for (int dx = 0; dx < dst_blocks_w[ci]; ++dx) {
+                    int sx = 0, sy = 0;
+                    source_block(t.op, dx, dy, ws, hs, &sx, &sy);
+                    const JCOEF* s = src_rows[sy][sx];
+                    JCOEF* d = row[dx];
+                    for (int k = 0; k < DCTSIZE2; ++k) d[k] = JCOEF(coef_sign[k] * s[coef_src[k]]);
+                }
+            }
+        }
+
+        jpeg_finish_compress(&dst);
+        jpeg_finish_decompress(&src);
+        return true;
+    }
+
+    jpeg_decompress_struct src;
+    jpeg_compress_struct dst;
+    ErrorMgr err;
+    VectorDest dest;
+
+    jvirt_barray_ptr dst_arrays[MAX_COMPONENTS];
+    int dst_blocks_w[MAX_COMPONENTS];
+    int dst_blocks_h[MAX_COMPONENTS];
+    std::vector<JBLOCKROW> src_rows;
+    int coef_src[DCTSIZE2];
+    int coef_sign[DCTSIZE2];
+    int out_width = 0;
+    int out_height = 0;
+};
@@ -0,0 +1,155 @@
+// .mjc 录制文件工具
+// 用法: mjc_tool <文件.mjc>                         列出帧信息
+//       mjc_tool <文件.mjc> <帧号> [输出.jpg]         导出单帧
+//       mjc_tool <文件.mjc> -t <秒> [输出.jpg]        导出相对开始 <秒> 处的帧
+//       mjc_tool <文件.mjc> avi <输出.avi> [帧率]     导出为 MJPEG AVI，超过 AVI 1.0 上限时自动分段
+// 编译: g++ -O2 -std=c++17 mjc_tool.cpp -o mjc_tool
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "avi_writer.h"
+#include "mjpeg_container.h"
+
+using namespace std;
+
+static void print_info(const MjcReader& r, const char* path) {
+    const MjcFileHeader& h = r.header();
+    printf("%s: %ux%u %c%c%c%c, %zu 帧%s\n", path, h.width, h.height,
+           h.fourcc & 0xFF, (h.fourcc >> 8) & 0xFF, (h.fourcc >> 16) & 0xFF, (h.fourcc >> 24) & 0xFF,
+           r.frame_count(), r.recovered ? "（录制未正常结束，部分索引由扫描重建）" : "");
+    if (r.frame_count() == 0) return;
+
+    uint64_t t0 = r.entry(0).timestamp_ns;
+    double span = (r.entry(r.frame_count() - 1).timestamp_ns - t0) / 1e9;
+    // 开启帧差门限录制时，未保存的帧只留有时间戳，不算作丢帧
+    vector<MjcSkipEntry> skipped;
+    r.read_skipped(skipped);
+    uint64_t total = 0;
+    uint32_t gaps = 0;
+    for (size_t i = 0; i < r.frame_count(); ++i) {
+        total += r.entry(i).size;
+        if (i > 0) gaps += r.entry(i).sequence - r.entry(i - 1).sequence - 1;
+    }
+    uint32_t last_seq = r.entry(r.frame_count() - 1).sequence;
+    for (const MjcSkipEntry& s : skipped)
+        if (s.sequence < last_seq && gaps > 0) gaps--;
+    if (span > 0)
+        printf("时长: %.2f 秒（%.2f FPS），平均每帧 %.1f KB，驱动侧丢帧 %u\n", span,
+               (r.frame_count() - 1) / span, total / 1024.0 / r.frame_count(), gaps);
+    if (!skipped.empty())
+        printf("帧差门限跳过 %zu 帧（%.1f%%）\n", skipped.size(),
+               100.0 * skipped.size() / (skipped.size() + r.frame_count()));
+
+    for (size_t i = 0; i < r.frame_count(); ++i) {
+        const MjcIndexEntry& e = r.entry(i);
+        printf("  #%zu seq=%u t=%.3f s size=%u offset=%llu\n", i, e.sequence,
+               (e.timestamp_ns - t0) / 1e9, e.size, (unsigned long long)e.offset);
+    }
+}
+
+static int extract(const MjcReader& r, size_t i, const char* out) {
+    vector<uint8_t> jpeg;
+    if (!r.read_frame(i, jpeg)) {
+        fprintf(stderr, "无法读取第 %zu 帧（共 %zu 帧）\n", i, r.frame_count());
+        return 1;
+    }
+    char filename[64];
+    if (!out) {
+        snprintf(filename, sizeof(filename), "frame_%08zu.jpg", i);
+        out = filename;
+    }
+    FILE* fp = fopen(out, "wb");
+    if (!fp || fwrite(jpeg.data(), 1, jpeg.size(), fp) != jpeg.size()) {
+        perror("写入帧失败");
+        if (fp) fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+    printf("第 %zu 帧（seq=%u）已保存到 %s（%zu 字节）\n", i, r.entry(i).sequence, out, jpeg.size());
+    return 0;
+}
+
+// 分段文件名：out.avi -> out_001.avi
+static string segment_name(const char* path, int n) {
+    if (n == 0) return path;
+    string p = path;
+    size_t dot = p.rfind('.');
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%03d", n);
+    return dot == string::npos ? p + suffix : p.substr(0, dot) + suffix + p.substr(dot);
+}
+
+static int export_avi(const MjcReader& r, const char* path, double fps) {
+    size_t n = r.frame_count();
+    if (n == 0) {
+        fprintf(stderr, "录制文件中没有帧\n");
+        return 1;
+    }
+    // 默认按时间戳计算平均帧率
+    if (fps <= 0) {
+        double span = (r.entry(n - 1).timestamp_ns - r.entry(0).timestamp_ns) / 1e9;
+        fps = n > 1 && span > 0 ? (n - 1) / span : 30.0;
+    }
+
+    const MjcFileHeader& h = r.header();
+    AviWriter avi;
+    int segment = 0;
+    string name = segment_name(path, 0);
+    if (!avi.open(name.c_str(), h.width, h.height, fps)) return 1;
+
+    vector<uint8_t> jpeg;
+    for (size_t i = 0; i < n; ++i) {
+        if (avi.full()) {
+            avi.close();
+            printf("%s: %u 帧\n", name.c_str(), avi.frame_count());
+            name = segment_name(path, ++segment);
+            if (!avi.open(name.c_str(), h.width, h.height, fps)) return 1;
+        }
+        if (!r.read_frame(i, jpeg)) {
+            fprintf(stderr, "第 %zu 帧已损坏，跳过\n", i);
+            continue;
+        }
+        if (!avi.add_frame(jpeg.data(), jpeg.size())) return 1;
+    }
+    uint32_t last = avi.frame_count();
+    if (!avi.close()) {
+        perror("写AVI索引失败");
+        return 1;
+    }
+    printf("%s: %u 帧，%.2f FPS\n", name.c_str(), last, fps);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "用法: %s <文件.mjc> [帧号 | -t 秒 | avi 输出.avi [帧率]] [输出]\n", argv[0]);
+        return 1;
+    }
+
+    MjcReader r;
+    if (!r.open(argv[1])) return 1;
+
+    if (argc == 2) {
+        print_info(r, argv[1]);
+        return 0;
+    }
+    if (strcmp(argv[2], "avi") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "缺少输出文件名\n");
+            return 1;
+        }
+        return export_avi(r, argv[3], argc > 4 ? atof(argv[4]) : 0);
+    }
+    if (strcmp(argv[2], "-t") == 0) {
+        if (argc < 4 || r.frame_count() == 0) return 1;
+        uint64_t t = r.entry(0).timestamp_ns + uint64_t(atof(argv[3]) * 1e9);
+        size_t i = r.find_frame(t);
+        if (i == r.frame_count()) i--;
+        return extract(r, i, argc > 4 ? argv[4] : nullptr);
+    }
+    return extract(r, strtoul(argv[2], nullptr, 10), argc > 3 ? argv[3] : nullptr);
+}
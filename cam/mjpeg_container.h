@@ -0,0 +1,498 @@
+#pragma once
+
+// 单文件 MJPEG 录制容器（.mjc），只追加写，长时间录制直接顺序写入持久存储
+//
+// 文件布局（小端）：
+//   MjcFileHeader，占 MJC_HEADER_SIZE 字节
+//   记录 * N，每条记录为 MjcRecordHeader + 负载，负载补齐到 8 字节：
+//     FRAME：一帧 JPEG，头部带 V4L2 sequence 和时间戳
+//     INDEX：检查点，MjcIndexChunk + MjcIndexEntry * count，覆盖上一检查点之后的帧
+//     SKIP：帧差门限丢弃的帧，MjcSkipEntry * count，用于重建完整时间线（版本 2）
+// 每 MJC_CHECKPOINT_FRAMES 帧或 MJC_CHECKPOINT_NS 纳秒写一个检查点，fdatasync 后
+// 再回写文件头中的 last_index。异常退出时读取端沿检查点链加载索引，
+// 再从最后一个检查点之后顺序扫描 FRAME 记录补齐。
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#define MJC_MAGIC             "MJPGCNT1"
+#define MJC_VERSION           2
+#define MJC_HEADER_SIZE       4096
+#define MJC_FRAME_MAGIC       0x314d5246u   // "FRM1"
+#define MJC_INDEX_MAGIC       0x31584449u   // "IDX1"
+#define MJC_SKIP_MAGIC        0x50494b53u   // "SKIP"
+#define MJC_FLAG_CLOSED       1u            // 文件头：录制正常结束
+#define MJC_CHECKPOINT_FRAMES 256
+#define MJC_CHECKPOINT_NS     5000000000ull
+#define MJC_WRITE_BUFFER      (1024 * 1024)
+
+struct MjcFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t width;
+    uint32_t height;
+    uint32_t fourcc;
+    uint32_t reserved0;
+    uint64_t last_index;      // 最后一个 INDEX 记录的偏移，0 表示还没有检查点
+    uint64_t indexed_frames;  // 截至 last_index 已建索引的帧数
+};
+
+struct MjcRecordHeader {
+    uint32_t magic;
+    uint32_t size;            // 负载长度（不含补齐）
+    uint32_t sequence;        // FRAME：V4L2 sequence
+    uint32_t reserved;
+    uint64_t timestamp_ns;    // FRAME：V4L2 时间戳
+};
+
+struct MjcIndexChunk {
+    uint64_t prev_index;      // 上一个 INDEX 记录的偏移，0 表示这是第一个
+    uint64_t count;
+};
+
+struct MjcIndexEntry {
+    uint64_t offset;          // FRAME 记录（记录头）在文件中的偏移
+    uint64_t timestamp_ns;
+    uint32_t size;            // JPEG 长度
+    uint32_t sequence;
+};
+
+struct MjcSkipEntry {
+    uint64_t timestamp_ns;
+    uint32_t sequence;
+    uint32_t score;           // 与关键帧的差异分数 * 100
+};
+
+static inline uint64_t mjc_padded(uint64_t size) { return (size + 7) & ~uint64_t(7); }
+
+static inline bool mjc_read_at(int fd, void* data, size_t size, uint64_t offset) {
+    uint8_t* p = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        ssize_t n = pread(fd, p, size, off_t(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+// 顺序写入目标。容器只做追加写，另外在检查点时回写文件头
+class ByteSink {
+public:
+    virtual ~ByteSink() {}
+    virtual bool append(const iovec* iov, int iovcnt) = 0;
+    virtual bool write_at(uint64_t offset, const void* data, size_t size) = 0;
+    // 把缓冲的数据写入文件并 fdatasync
+    virtual bool sync() = 0;
+    virtual bool close() = 0;
+    virtual uint64_t position() const = 0;
+};
+
+// 普通文件：小块（记录头、索引）先攒在缓冲中，遇到大帧时与缓冲一起 writev，
+// 每次系统调用都是大块顺序写
+class FileSink : public ByteSink {
+public:
+    ~FileSink() override { close(); }
+
+    bool open(const char* path) {
+        fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            perror("无法创建录制文件");
+            return false;
+        }
+        buf.reserve(MJC_WRITE_BUFFER);
+        return true;
+    }
+
+    bool append(const iovec* iov, int iovcnt) override {
+        size_t total = 0;
+        for (int i = 0; i < iovcnt; ++i) total += iov[i].iov_len;
+
+        if (buf.size() + total <= MJC_WRITE_BUFFER) {
+            for (int i = 0; i < iovcnt; ++i) {
+                const uint8_t* p = static_cast<const uint8_t*>(iov[i].iov_base);
+                buf.insert(buf.end(), p, p + iov[i].iov_len);
+            }
+            pos += total;
+            return true;
+        }
+
+        // 缓冲放不下：缓冲内容和本次数据一次 writev 写出
+        std::vector<iovec> v;
+        v.reserve(iovcnt + 1);
+        if (!buf.empty()) v.push_back({buf.data(), buf.size()});
+        v.insert(v.end(), iov, iov + iovcnt);
+        if (!writev_all(v.data(), int(v.size()))) return false;
+        buf.clear();
+        pos += total;
+        return true;
+    }
+
+    bool write_at(uint64_t offset, const void* data, size_t size) override {
+        // 目标区域可能还在缓冲里，先写出缓冲，避免随后被旧内容覆盖
+        if (!flush()) return false;
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            ssize_t n = pwrite(fd, p, size, off_t(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            size -= n;
+            offset += n;
+        }
+        return true;
+    }
+
+    bool sync() override {
+        if (!flush()) return false;
+        return fdatasync(fd) == 0;
+    }
+
+    bool close() override {
+        if (fd < 0) return true;
+        bool ok = flush();
+        if (::close(fd) != 0) ok = false;
+        fd = -1;
+        return ok;
+    }
+
+    uint64_t position() const override { return pos; }
+
+private:
+    bool flush() {
+        if (buf.empty()) return true;
+        iovec v = {buf.data(), buf.size()};
+        if (!writev_all(&v, 1)) return false;
+        buf.clear();
+        return true;
+    }
+
+    bool writev_all(iovec* iov, int n) {
+        while (n > 0) {
+            ssize_t w = ::writev(fd, iov, std::min(n, IOV_MAX));
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return false;
+            // 处理部分写入
+            while (n > 0 && size_t(w) >= iov->iov_len) {
+                w -= iov->iov_len;
+                ++iov;
+                --n;
+            }
+            if (n > 0) {
+                iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + w;
+                iov->iov_len -= w;
+            }
+        }
+        return true;
+    }
+
+    int fd = -1;
+    uint64_t pos = 0;
+    std::vector<uint8_t> buf;
+};
+
+// ========================= 写入端 =========================
+class MjcWriter {
+public:
+    ~MjcWriter() { close(); }
+
+    bool open(const char* path, int width, int height, uint32_t fourcc) {
+        std::unique_ptr<FileSink> file(new FileSink);
+        if (!file->open(path)) return false;
+        return open(std::move(file), width, height, fourcc);
+    }
+
+    // 使用调用方提供的写入目标（例如 O_DIRECT 写入器）
+    bool open(std::unique_ptr<ByteSink> s, int width, int height, uint32_t fourcc) {
+        sink = std::move(s);
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, MJC_MAGIC, 8);
+        hdr.version = MJC_VERSION;
+        hdr.width = width;
+        hdr.height = height;
+        hdr.fourcc = fourcc;
+
+        std::vector<uint8_t> block(MJC_HEADER_SIZE, 0);
+        memcpy(block.data(), &hdr, sizeof(hdr));
+        iovec v = {block.data(), block.size()};
+        if (!sink->append(&v, 1)) {
+            perror("写录制文件头失败");
+            sink.reset();
+            return false;
+        }
+        // 统计在多次 open（分段、多个事件文件）之间累计
+        pending.clear();
+        last_checkpoint_ns = 0;
+        return true;
+    }
+
+    bool write_frame(const void* jpeg, size_t size, uint32_t sequence, uint64_t timestamp_ns) {
+        if (!sink || !flush_skipped()) return false;
+        MjcRecordHeader rec = {MJC_FRAME_MAGIC, uint32_t(size), sequence, 0, timestamp_ns};
+        uint64_t offset = sink->position();
+        if (!append_record(rec, jpeg, size)) {
+            perror("写入帧失败");
+            return false;
+        }
+        pending.push_back({offset, timestamp_ns, uint32_t(size), sequence});
+        frames++;
+        bytes += size;
+
+        if (last_checkpoint_ns == 0) last_checkpoint_ns = timestamp_ns;
+        if (pending.size() >= MJC_CHECKPOINT_FRAMES ||
+            timestamp_ns - last_checkpoint_ns >= MJC_CHECKPOINT_NS)
+            return checkpoint();
+        return true;
+    }
+
+    // 记录一帧被丢弃（未写入数据）；攒成一条 SKIP 记录，在下一帧写入前写出
+    bool skip_frame(uint32_t sequence, uint64_t timestamp_ns, double score) {
+        if (!sink) return false;
+        skipped_pending.push_back({timestamp_ns, sequence, uint32_t(score * 100 + 0.5)});
+        skipped++;
+        if (skipped_pending.size() >= MJC_CHECKPOINT_FRAMES) return flush_skipped();
+        return true;
+    }
+
+    // 写 INDEX 记录并落盘，然后回写文件头指向它
+    bool checkpoint() {
+        if (!sink || pending.empty()) return true;
+        auto t0 = std::chrono::steady_clock::now();
+
+        MjcIndexChunk chunk = {hdr.last_index, pending.size()};
+        size_t payload = sizeof(chunk) + pending.size() * sizeof(MjcIndexEntry);
+        std::vector<uint8_t> data(payload);
+        memcpy(data.data(), &chunk, sizeof(chunk));
+        memcpy(data.data() + sizeof(chunk), pending.data(), pending.size() * sizeof(MjcIndexEntry));
+
+        MjcRecordHeader rec = {MJC_INDEX_MAGIC, uint32_t(payload), 0, 0, 0};
+        uint64_t offset = sink->position();
+        if (!append_record(rec, data.data(), payload) || !sink->sync()) {
+            perror("写入索引检查点失败");
+            return false;
+        }
+        hdr.last_index = offset;
+        hdr.indexed_frames += pending.size();
+        if (!sink->write_at(0, &hdr, sizeof(hdr))) {
+            perror("回写录制文件头失败");
+            return false;
+        }
+
+        pending.clear();
+        last_checkpoint_ns = 0;
+        checkpoints++;
+        checkpoint_sec += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return true;
+    }
+
+    bool close() {
+        if (!sink) return true;
+        bool ok = flush_skipped();
+        ok = checkpoint() && ok;
+        hdr.flags |= MJC_FLAG_CLOSED;
+        ok = sink->write_at(0, &hdr, sizeof(hdr)) && ok;
+        ok = sink->close() && ok;
+        sink.reset();
+        return ok;
+    }
+
+    void print_summary(double wall_sec) const {
+        double mb = bytes / (1024.0 * 1024.0);
+        printf("录制文件: %llu 帧，%.1f MB，%.1f MB/s，检查点 %d 个（共耗时 %.3f 秒）\n",
+               (unsigned long long)frames, mb, wall_sec > 0 ? mb / wall_sec : 0.0,
+               checkpoints, checkpoint_sec);
+        if (skipped)
+            printf("  帧差门限跳过 %llu 帧（%.1f%%）\n", (unsigned long long)skipped,
+                   100.0 * skipped / (skipped + frames));
+    }
+
+    uint64_t frame_count() const { return frames; }
+    uint64_t file_size() const { return sink ? sink->position() : 0; }
+
+private:
+    bool flush_skipped() {
+        if (skipped_pending.empty()) return true;
+        size_t payload = skipped_pending.size() * sizeof(MjcSkipEntry);
+        MjcRecordHeader rec = {MJC_SKIP_MAGIC, uint32_t(payload), uint32_t(skipped_pending.size()), 0,
+                               skipped_pending.front().timestamp_ns};
+        if (!append_record(rec, skipped_pending.data(), payload)) {
+            perror("写入跳帧记录失败");
+            return false;
+        }
+        skipped_pending.clear();
+        return true;
+    }
+
+    bool append_record(const MjcRecordHeader& rec, const void* data, size_t size) {
+        static const uint8_t zeros[8] = {};
+        iovec v[3] = {
+            {const_cast<MjcRecordHeader*>(&rec), sizeof(rec)},
+            {const_cast<void*>(data), size},
+            {const_cast<uint8_t*>(zeros), size_t(mjc_padded(size) - size)},
+        };
+        return sink->append(v, v[2].iov_len ? 3 : 2);
+    }
+
+    std::unique_ptr<ByteSink> sink;
+    MjcFileHeader hdr;
+    std::vector<MjcIndexEntry> pending;   // 上一检查点之后写入的帧
+    std::vector<MjcSkipEntry> skipped_pending;
+    uint64_t skipped = 0;
+    uint64_t last_checkpoint_ns = 0;
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    int checkpoints = 0;
+    double checkpoint_sec = 0;
+};
+
+// ========================= 读取端 =========================
+class MjcReader {
+public:
+    ~MjcReader() { close(); }
+
+    bool open(const char* path) {
+        fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            perror("无法打开录制文件");
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || !mjc_read_at(fd, &hdr, sizeof(hdr), 0) ||
+            memcmp(hdr.magic, MJC_MAGIC, 8) != 0 || hdr.version < 1 || hdr.version > MJC_VERSION) {
+            fprintf(stderr, "%s 不是有效的 MJC 录制文件\n", path);
+            close();
+            return false;
+        }
+        file_size = uint64_t(st.st_size);
+
+        uint64_t scan_from = MJC_HEADER_SIZE;
+        if (hdr.last_index) {
+            if (!load_checkpoints()) {
+                fprintf(stderr, "%s 的索引已损坏，按顺序扫描重建\n", path);
+                index.clear();
+            } else {
+                MjcRecordHeader rec;
+                mjc_read_at(fd, &rec, sizeof(rec), hdr.last_index);
+                scan_from = hdr.last_index + sizeof(rec) + mjc_padded(rec.size);
+            }
+        }
+        // 最后一个检查点之后的帧（或索引损坏时的全部帧）靠扫描记录补齐
+        size_t indexed = index.size();
+        scan(scan_from);
+        recovered = !(hdr.flags & MJC_FLAG_CLOSED) || index.size() != indexed;
+        return true;
+    }
+
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    size_t frame_count() const { return index.size(); }
+    const MjcIndexEntry& entry(size_t i) const { return index[i]; }
+    const MjcFileHeader& header() const { return hdr; }
+    int file() const { return fd; }
+
+    // 读取第 i 帧的 JPEG 数据，失败返回 false
+    bool read_frame(size_t i, std::vector<uint8_t>& out) const {
+        if (i >= index.size()) return false;
+        const MjcIndexEntry& e = index[i];
+        if (e.offset > file_size || file_size - e.offset < sizeof(MjcRecordHeader) + uint64_t(e.size))
+            return false;   // 损坏的索引项
+        out.resize(e.size);
+        return mjc_read_at(fd, out.data(), e.size, e.offset + sizeof(MjcRecordHeader));
+    }
+
+    // 返回时间戳不早于 timestamp_ns 的第一帧，全部更早时返回 frame_count()
+    size_t find_frame(uint64_t timestamp_ns) const {
+        auto it = std::lower_bound(index.begin(), index.end(), timestamp_ns,
+                                   [](const MjcIndexEntry& e, uint64_t t) { return e.timestamp_ns < t; });
+        return size_t(it - index.begin());
+    }
+
+    // 读出所有 SKIP 记录（按时间顺序），与帧索引合并即可还原完整时间线。
+    // 只读记录头逐条跳过帧数据，不读取 JPEG
+    bool read_skipped(std::vector<MjcSkipEntry>& out) const {
+        out.clear();
+        uint64_t offset = MJC_HEADER_SIZE;
+        MjcRecordHeader rec;
+        while (offset + sizeof(rec) <= file_size && mjc_read_at(fd, &rec, sizeof(rec), offset)) {
+            uint64_t end = offset + sizeof(rec) + mjc_padded(rec.size);
+            if (!valid_magic(rec.magic) || end > file_size) break;
+            if (rec.magic == MJC_SKIP_MAGIC) {
+                size_t n = rec.size / sizeof(MjcSkipEntry);
+                out.resize(out.size() + n);
+                if (!mjc_read_at(fd, out.data() + out.size() - n, n * sizeof(MjcSkipEntry), offset + sizeof(rec)))
+                    return false;
+            }
+            offset = end;
+        }
+        return true;
+    }
+
+    bool recovered = false;   // 录制未正常结束，部分索引由扫描得到
+
+private:
+    static bool valid_magic(uint32_t magic) {
+        return magic == MJC_FRAME_MAGIC || magic == MJC_INDEX_MAGIC || magic == MJC_SKIP_MAGIC;
+    }
+
+    // 从 last_index 沿 prev_index 链向前读取所有检查点，再按文件顺序拼接
+    bool load_checkpoints() {
+        std::vector<std::vector<MjcIndexEntry>> chunks;
+        uint64_t offset = hdr.last_index;
+        while (offset) {
+            MjcRecordHeader rec;
+            MjcIndexChunk chunk;
+            if (offset + sizeof(rec) + sizeof(chunk) > file_size ||
+                !mjc_read_at(fd, &rec, sizeof(rec), offset) || rec.magic != MJC_INDEX_MAGIC ||
+                !mjc_read_at(fd, &chunk, sizeof(chunk), offset + sizeof(rec)) ||
+                // 先按文件大小限制 count，再比较长度（乘法不会回绕），避免按损坏的 count 申请巨大的内存
+                offset + sizeof(rec) + rec.size > file_size ||
+                chunk.count > (file_size - offset) / sizeof(MjcIndexEntry) ||
+                rec.size != sizeof(chunk) + chunk.count * sizeof(MjcIndexEntry) ||
+                chunk.prev_index >= offset)
+                return false;
+            std::vector<MjcIndexEntry> entries(chunk.count);
+            if (!mjc_read_at(fd, entries.data(), chunk.count * sizeof(MjcIndexEntry),
+                             offset + sizeof(rec) + sizeof(chunk)))
+                return false;
+            chunks.push_back(std::move(entries));
+            offset = chunk.prev_index;
+        }
+        for (auto it = chunks.rbegin(); it != chunks.rend(); ++it)
+            index.insert(index.end(), it->begin(), it->end());
+        return true;
+    }
+
+    void scan(uint64_t offset) {
+        MjcRecordHeader rec;
+        while (offset + sizeof(rec) <= file_size && mjc_read_at(fd, &rec, sizeof(rec), offset)) {
+            uint64_t end = offset + sizeof(rec) + mjc_padded(rec.size);
+            if (!valid_magic(rec.magic) || end > file_size)
+                break;   // 记录不完整：异常退出时最后一帧只写了一部分
+            if (rec.magic == MJC_FRAME_MAGIC)
+                index.push_back({offset, rec.timestamp_ns, rec.size, rec.sequence});
+            offset = end;
+        }
+    }
+
+    int fd = -1;
+    uint64_t file_size = 0;
+    MjcFileHeader hdr;
+    std::vector<MjcIndexEntry> index;
+};
@@ -0,0 +1,295 @@
+#pragma once
+
+// 无界面设备上的 MJPEG-over-HTTP 预览（multipart/x-mixed-replace），浏览器或 ffplay/VLC 直接打开：
+//   /          简单页面
+//   /stream    摄像头原始 JPEG 帧，原样转发，不解码不重新编码
+//   /preview   缩小/叠加信息后的预览帧（由调用方生成，只在有人观看时才需要生成）
+//   任一路径可加 ?fps=N 限制该客户端的帧率（不超过服务器上限）
+// 每个客户端一个发送线程，总是只发送最新的一帧：发送慢的客户端跳过中间帧，
+// 发送超时的客户端直接断开，发布帧的一方（采集线程）从不等待客户端。
+// 默认只监听 127.0.0.1，远程查看通过 ssh -L 转发。
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+enum class HttpStream { Raw = 0, Preview = 1 };
+
+struct HttpServerConfig {
+    const char* bind_addr = "127.0.0.1";
+    int port = 8080;
+    double max_fps = 15;        // 每个客户端的帧率上限
+    int send_timeout_ms = 2000; // 一帧在这段时间内发不出去就断开该客户端
+    int max_clients = 4;
+};
+
+class MjpegHttpServer {
+public:
+    ~MjpegHttpServer() { stop(); }
+
+    bool start(const HttpServerConfig& config) {
+        cfg = config;
+        listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0) {
+            perror("创建 HTTP 套接字失败");
+            return false;
+        }
+        int one = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(uint16_t(cfg.port));
+        if (inet_pton(AF_INET, cfg.bind_addr, &addr.sin_addr) != 1) {
+            fprintf(stderr, "无效的监听地址: %s\n", cfg.bind_addr);
+            close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 8) < 0) {
+            perror("HTTP 监听失败");
+            close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        running = true;
+        accept_thread = std::thread(&MjpegHttpServer::accept_loop, this);
+        printf("HTTP 预览: http://%s:%d/（原始帧 /stream，预览 /preview）\n", cfg.bind_addr, cfg.port);
+        return true;
+    }
+
+    void stop() {
+        if (!running.exchange(false)) return;
+        accept_thread.join();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Client& c : clients) shutdown(c.fd, SHUT_RDWR);   // 打断阻塞中的 send/recv
+        }
+        updated.notify_all();
+        for (Client& c : clients) {
+            c.thread.join();
+            close(c.fd);
+        }
+        clients.clear();
+        close(listen_fd);
+        listen_fd = -1;
+    }
+
+    // 该路有没有客户端在看：没有时调用方不必生成（也不必发布）这一路的帧
+    bool wants(HttpStream s) const { return watchers[int(s)].load(std::memory_order_relaxed) > 0; }
+
+    // 发布一帧 JPEG。没人观看时直接返回；否则只拷贝一次，由各客户端线程共享
+    void publish(HttpStream s, const uint8_t* jpeg, size_t size) {
+        if (!wants(s)) return;
+        auto frame = std::make_shared<const std::vector<uint8_t>>(jpeg, jpeg + size);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            latest[int(s)].swap(frame);
+            sequence[int(s)]++;
+        }
+        updated.notify_all();   // 旧帧在锁外释放
+    }
+
+    void print_summary() const {
+        printf("HTTP 预览: %llu 个客户端，发送 %llu 帧（%.1f MB），限速或发送慢跳过 %llu 帧，超时断开 %llu 个\n",
+               (unsigned long long)clients_served.load(), (unsigned long long)frames_sent.load(),
+               bytes_sent.load() / (1024.0 * 1024.0), (unsigned long long)frames_skipped.load(),
+               (unsigned long long)clients_dropped.load());
+    }
+
+private:
+    struct Client {
+        int fd;
+        std::thread thread;
+        std::atomic<bool> finished{false};
+    };
+
+    void accept_loop() {
+        while (running) {
+            pollfd pfd = {listen_fd, POLLIN, 0};
+            if (poll(&pfd, 1, 200) <= 0) {
+                reap();
+                continue;
+            }
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) continue;
+            reap();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (int(clients.size()) >= cfg.max_clients) {
+                static const char busy[] = "HTTP/1.0 503 Service Unavailable\r\nConnection: close\r\n\r\n";
+                send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+                close(fd);
+                continue;
+            }
+            clients.emplace_back();
+            Client& c = clients.back();
+            c.fd = fd;
+            c.thread = std::thread(&MjpegHttpServer::serve, this, &c);
+            clients_served++;
+        }
+    }
+
+    // 回收已经结束的客户端线程。套接字在这里才关闭，stop() 对它调用 shutdown 时不会碰到被复用的描述符
+    void reap() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = clients.begin(); it != clients.end();) {
+            if (it->finished) {
+                it->thread.join();
+                close(it->fd);
+                it = clients.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    bool send_all(int fd, const void* data, size_t size) {
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) clients_dropped++;
+                return false;
+            }
+            p += n;
+            size -= size_t(n);
+        }
+        return true;
+    }
+
+    void serve(Client* c) {
+        timeval tv = {cfg.send_timeout_ms / 1000, (cfg.send_timeout_ms % 1000) * 1000};
+        setsockopt(c->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        // 限制内核发送缓冲，积压的旧帧少，慢客户端的延迟也就不会越积越大
+        int sndbuf = 256 * 1024;
+        setsockopt(c->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+        // 只关心请求行，读到头部结束或缓冲满为止
+        char request[2048];
+        size_t len = 0;
+        while (len < sizeof(request) - 1) {
+            ssize_t n = recv(c->fd, request + len, sizeof(request) - 1 - len, 0);
+            if (n <= 0) break;
+            len += size_t(n);
+            request[len] = '\0';
+            if (strstr(request, "\r\n\r\n")) break;
+        }
+        request[len] = '\0';
+
+        char path[256] = "";
+        if (sscanf(request, "GET %255s", path) == 1) {
+            char* query = strchr(path, '?');
+            double fps = cfg.max_fps;
+            if (query) {
+                *query++ = '\0';
+                const char* p = strstr(query, "fps=");
+                if (p && atof(p + 4) > 0) fps = std::min(fps, atof(p + 4));
+            }
+            if (strcmp(path, "/stream") == 0) {
+                stream(c->fd, HttpStream::Raw, fps);
+            } else if (strcmp(path, "/preview") == 0) {
+                stream(c->fd, HttpStream::Preview, fps);
+            } else if (strcmp(path, "/") == 0) {
+                static const char page[] =
+                    "HTTP/1.0 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nConnection: close\r\n\r\n"
+                    "<html><body style=\"margin:0;background:#000\">"
+                    "<img src=\"/preview\" style=\"max-width:100%\"></body></html>\n";
+                send_all(c->fd, page, sizeof(page) - 1);
+            } else {
+                static const char missing[] = "HTTP/1.0 404 Not Found\r\nConnection: close\r\n\r\n";
+                send_all(c->fd, missing, sizeof(missing) - 1);
+            }
+        }
+        shutdown(c->fd, SHUT_RDWR);
+        c->finished = true;
+    }
+
+    void stream(int fd, HttpStream s, double fps) {
+        static const char header[] =
+            "HTTP/1.0 200 OK\r\n"
+            "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+            "Cache-Control: no-cache\r\nPragma: no-cache\r\nConnection: close\r\n\r\n";
+        if (!send_all(fd, header, sizeof(header) - 1)) return;
+
+        const int i = int(s);
+        watchers[i]++;
+        const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / fps));
+        auto next = std::chrono::steady_clock::now();
+        uint64_t sent_seq;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sent_seq = sequence[i];
+        }
+        while (running) {
+            std::shared_ptr<const std::vector<uint8_t>> frame;
+            uint64_t seq;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                updated.wait_for(lock, std::chrono::milliseconds(200),
+                                 [&] { return !running || sequence[i] != sent_seq; });
+                if (sequence[i] == sent_seq) continue;
+                frame = latest[i];
+                seq = sequence[i];
+            }
+            // 发送期间到达、没赶上的帧都算跳过
+            if (seq - sent_seq > 1) frames_skipped += seq - sent_seq - 1;
+            sent_seq = seq;
+
+            char part[128];
+            int n = snprintf(part, sizeof(part), "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n",
+                             frame->size());
+            if (!send_all(fd, part, size_t(n)) || !send_all(fd, frame->data(), frame->size()) ||
+                !send_all(fd, "\r\n", 2))
+                break;
+            frames_sent++;
+            bytes_sent += frame->size();
+
+            // 每个客户端单独限速：到点之前不取新帧
+            next += interval;
+            auto now = std::chrono::steady_clock::now();
+            if (next < now) next = now;
+            else std::this_thread::sleep_until(next);
+        }
+        watchers[i]--;
+    }
+
+    HttpServerConfig cfg;
+    int listen_fd = -1;
+    std::atomic<bool> running{false};
+    std::thread accept_thread;
+
+    std::mutex mutex;
+    std::condition_variable updated;
+    std::list<Client> clients;                              // list：元素地址在增删时保持不变
+    std::shared_ptr<const std::vector<uint8_t>> latest[2];  // 每路最新一帧
+    uint64_t sequence[2] = {0, 0};
+    std::atomic<int> watchers[2] = {{0}, {0}};
+
+    std::atomic<uint64_t> clients_served{0};
+    std::atomic<uint64_t> frames_sent{0};
+    std::atomic<uint64_t> bytes_sent{0};
+    std::atomic<uint64_t> frames_skipped{0};
+    std::atomic<uint64_t> clients_dropped{0};
+};
@@ -3,13 +3,18 @@
 #include <iostream>
 #include <thread>
 #include <atomic>
-#include <mutex>
 #include <queue>
 #include <libv4l2.h>
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <getopt.h>
+#include <unistd.h>
+#include "triple_buffer.h"
+#include "mjpeg_http_server.h"
 
 using namespace cv;
 using namespace std;
@@ -18,8 +23,42 @@ using namespace std;
 atomic<bool> done(false);
 atomic<int> frames_displayed(0);
 atomic<int> frames_captured(0);
-Mat current_frame;
-mutex frame_mutex;
+double latency_total_ms = 0;   // 只由显示线程更新，结束后在主线程读取
+double latency_max_ms = 0;
+int frame_width = 0;   // 协商后的分辨率，采集线程在第一帧发布前写入
+int frame_height = 0;
+#define UI_POLL_MS 30      // 没有新帧时最多等待这么久就处理一次窗口事件
+#define PREVIEW_WIDTH 1280 // 默认预览尺寸（按原图比例缩放到不超过该尺寸）
+#define PREVIEW_HEIGHT 960
+#define PREVIEW_FPS 15     // 默认预览帧率上限
+#define PREVIEW_NICE 10    // 预览线程的 nice 值，CPU 紧张时让给采集和其他进程
+#define HTTP_PREVIEW_QUALITY 75  // /preview 预览帧的 JPEG 质量（/stream 原样转发，不重新编码）
+
+// 预览配置
+struct PreviewConfig {
+    int width = PREVIEW_WIDTH;
+    int height = PREVIEW_HEIGHT;
+    double max_fps = PREVIEW_FPS;
+};
+PreviewConfig preview;
+bool show_window = true;   // -N 时不开窗口（无界面设备），只通过 HTTP 查看
+MjpegHttpServer http;      // -H 时启动；没有客户端时 publish 直接返回
+atomic<int> frames_previewed(0);
+double preview_decode_sec = 0;   // 只由预览线程更新
+
+// 采集到的原始 MJPEG 帧（全分辨率，未解码）
+struct JpegFrame {
+    vector<uchar> data;
+    uint64_t timestamp_ns;  // V4L2 时间戳（CLOCK_MONOTONIC）
+};
+
+// 显示尺寸的一帧及其采集时间，用于统计采集到显示的延迟
+struct DisplayFrame {
+    Mat image;
+    uint64_t timestamp_ns;
+};
+TripleBuffer<JpegFrame> jpeg_frames;   // 采集线程 -> 预览线程
+TripleBuffer<DisplayFrame> frames;     // 预览线程 -> 显示线程
 
 // 直接捕获MJPEG帧的线程
 void capture_thread(int fd, double duration) {
@@ -37,6 +76,8 @@ void capture_thread(int fd, double duration) {
         perror("设置MJPEG格式失败");
         return;
     }
+    frame_width = fmt.fmt.pix.width;
+    frame_height = fmt.fmt.pix.height;
     
     // 分配缓冲区
     struct v4l2_requestbuffers req = {};
@@ -106,26 +147,15 @@ void capture_thread(int fd, double duration) {
             continue;
         }
         
-        // 获取帧数据
+        // 采集线程不解码也不缩放：全分辨率 JPEG 原样留给录制、OCR 等使用，
+        // 预览只取一份压缩数据的拷贝（约 1~2 MB），交接时只交换槽下标
+        JpegFrame& jpeg = jpeg_frames.back();
         uchar* src = static_cast<uchar*>(buffer_pointers[buf.index]);
-        vector<uchar> jpeg_data(src, src + buf.bytesused);
-        
-        // 使用硬件加速解码（如果可用）
-        Mat frame;
-        try {
-            frame = imdecode(jpeg_data, IMREAD_COLOR );
-        } catch (...) {
-            cerr << "解码帧失败" << endl;
-        }
-        
-        if (!frame.empty()) {
-            // 更新当前帧（带锁保护）
-            {
-                lock_guard<mutex> lock(frame_mutex);
-                current_frame = frame.clone();  // 克隆确保显示线程安全
-            }
-            frames_captured++;
-        }
+        jpeg.data.assign(src, src + buf.bytesused);
+        jpeg.timestamp_ns = uint64_t(buf.timestamp.tv_sec) * 1000000000ull + buf.timestamp.tv_usec * 1000ull;
+        jpeg_frames.publish();
+        http.publish(HttpStream::Raw, src, buf.bytesused);   // 原始帧原样转发，仅在有客户端时拷贝
+        frames_captured++;
         
         // 重新入队缓冲区
         if (ioctl(fd, VIDIOC_QBUF, &buf) < 0) {
@@ -147,59 +177,205 @@ void capture_thread(int fd, double duration) {
     done = true;
 }
 
-// 显示线程函数
+// 按显示尺寸选择解码缩小倍数：libjpeg 在 DCT 阶段缩小到 1/2、1/4、1/8，
+// 选仍不小于目标尺寸的最大倍数，剩下的用 resize 缩放
+static int preview_reduce(const Size& src, const Size& dst) {
+    for (int r : {8, 4, 2})
+        if (src.width / r >= dst.width && src.height / r >= dst.height) return r;
+    return 1;
+}
+
+static int reduced_color_flag(int reduce) {
+    switch (reduce) {
+    case 8: return IMREAD_REDUCED_COLOR_8;
+    case 4: return IMREAD_REDUCED_COLOR_4;
+    case 2: return IMREAD_REDUCED_COLOR_2;
+    default: return IMREAD_COLOR;
+    }
+}
+
+// 预览线程：取最新一帧 JPEG，缩小解码到显示尺寸后交给显示线程，有 HTTP 客户端时再叠加信息编码给 /preview；
+// 帧率受 max_fps 限制，其间到达的帧直接被三缓冲覆盖。窗口和 /preview 都没人用时不解码
+void preview_thread() {
+    setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), PREVIEW_NICE);
+    const auto interval = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(1.0 / preview.max_fps));
+    auto next = chrono::steady_clock::now();
+    Size src_size, dst_size;
+    int reduce = 1;
+    Mat decoded;
+    vector<uchar> http_jpeg;
+    const vector<int> http_params = {IMWRITE_JPEG_QUALITY, HTTP_PREVIEW_QUALITY};
+    int sequence = 0;
+    
+    while (!done) {
+        if (!jpeg_frames.wait_update(UI_POLL_MS)) continue;
+        sequence++;
+        bool serve = http.wants(HttpStream::Preview);
+        if (!show_window && !serve) continue;
+        const JpegFrame& jpeg = jpeg_frames.front();
+        auto t0 = chrono::steady_clock::now();
+        
+        // 分辨率在第一帧发布前已确定；按原图比例缩放到不超过预览尺寸
+        if (src_size.width == 0) {
+            src_size = Size(frame_width, frame_height);
+            double scale = min(double(preview.width) / src_size.width, double(preview.height) / src_size.height);
+            if (scale > 1) scale = 1;
+            dst_size = Size(int(src_size.width * scale), int(src_size.height * scale));
+            reduce = preview_reduce(src_size, dst_size);
+            printf("预览: %dx%d（1/%d 解码%s），最高 %.0f FPS\n", dst_size.width, dst_size.height, reduce,
+                   src_size.width / reduce == dst_size.width ? "" : " + 缩放", preview.max_fps);
+        }
+        
+        DisplayFrame& out = frames.back();
+        Mat encoded(1, int(jpeg.data.size()), CV_8UC1, const_cast<uchar*>(jpeg.data.data()));
+        bool exact = src_size.width / reduce == dst_size.width && src_size.height / reduce == dst_size.height;
+        try {
+            imdecode(encoded, reduced_color_flag(reduce), exact ? &out.image : &decoded);
+        } catch (...) {
+            cerr << "解码帧失败" << endl;
+            continue;
+        }
+        Mat& result = exact ? out.image : decoded;
+        if (result.empty()) continue;
+        if (!exact) resize(decoded, out.image, dst_size, 0, 0, INTER_AREA);
+        out.timestamp_ns = jpeg.timestamp_ns;
+        if (serve) {
+            // 叠加本地时间和帧号（窗口里同样可见），只有 /preview 有客户端时才重新编码
+            char text[64];
+            time_t now = time(nullptr);
+            size_t n = strftime(text, sizeof(text), "%H:%M:%S", localtime(&now));
+            snprintf(text + n, sizeof(text) - n, "  #%d", sequence);
+            putText(out.image, text, Point(20, out.image.rows - 20), FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0, 255, 0), 2);
+            if (imencode(".jpg", out.image, http_jpeg, http_params))
+                http.publish(HttpStream::Preview, http_jpeg.data(), http_jpeg.size());
+        }
+        if (show_window) frames.publish();
+        frames_previewed++;
+        preview_decode_sec += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        
+        // 帧率上限：到下一个时间点之前不取新帧
+        next += interval;
+        auto now = chrono::steady_clock::now();
+        if (next < now) next = now;
+        else this_thread::sleep_until(next);
+    }
+}
+
+// 显示线程函数：帧已经是显示尺寸，窗口按原样显示，不再由 highgui 缩放
 void display_thread() {
     // 创建显示窗口
-    namedWindow("HighRes Preview", WINDOW_NORMAL);
-    resizeWindow("HighRes Preview", 3264, 2448);  // 以较低的分辨率显示
+    namedWindow("HighRes Preview", WINDOW_AUTOSIZE);
     
     double fps = 0.0;
+    double latency_ms = 0.0;
     auto last_fps_time = chrono::steady_clock::now();
     int fps_frame_count = 0;
+    double latency_sum = 0;
     
     while (!done) {
-        Mat display_frame;
-        {
-            lock_guard<mutex> lock(frame_mutex);
-            if (!current_frame.empty()) {
-                display_frame = current_frame;
-            }
+        // 睡眠等待新帧，超时后也要处理一次窗口事件；每个新帧只渲染一次
+        bool new_frame = frames.wait_update(UI_POLL_MS);
+        if (new_frame) {
+            DisplayFrame& frame = frames.front();
+            // 在帧上显示实际呈现的帧率和延迟（front() 只归显示线程，可以直接叠加文字）
+            char text[64];
+            snprintf(text, sizeof(text), "FPS: %.1f  latency: %.0f ms", fps, latency_ms);
+            putText(frame.image, text, Point(20, 40), FONT_HERSHEY_SIMPLEX, 1, Scalar(0, 255, 0), 2);
+            imshow("HighRes Preview", frame.image);
         }
         
-        if (!display_frame.empty()) {
-            // 在帧上显示FPS
-            putText(display_frame, "FPS: " + to_string(fps), Point(20, 40), 
-                    FONT_HERSHEY_SIMPLEX, 1, Scalar(0, 255, 0), 2);
-            
-            // 显示帧
-            imshow("HighRes Preview", display_frame);
+        // 处理键盘事件（按ESC退出），窗口在这里真正重绘
+        int key = waitKey(1);
+        
+        if (new_frame) {
+            // 采集到呈现的延迟：steady_clock 与 V4L2 时间戳同为 CLOCK_MONOTONIC
+            uint64_t presented_ns = uint64_t(chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now().time_since_epoch()).count());
+            double latency = (presented_ns - frames.front().timestamp_ns) / 1e6;
             frames_displayed++;
-            
-            // 计算FPS
             fps_frame_count++;
-            auto now = chrono::steady_clock::now();
-            chrono::duration<double> elapsed = now - last_fps_time;
-            if (elapsed.count() >= 1.0) {
-                fps = fps_frame_count / elapsed.count();
-                fps_frame_count = 0;
-                last_fps_time = now;
-            }
+            latency_sum += latency;
+            latency_total_ms += latency;
+            if (latency > latency_max_ms) latency_max_ms = latency;
+        }
+        
+        // 每秒更新一次帧率和平均延迟
+        auto now = chrono::steady_clock::now();
+        chrono::duration<double> elapsed = now - last_fps_time;
+        if (elapsed.count() >= 1.0) {
+            fps = fps_frame_count / elapsed.count();
+            latency_ms = fps_frame_count ? latency_sum / fps_frame_count : 0.0;
+            fps_frame_count = 0;
+            latency_sum = 0;
+            last_fps_time = now;
         }
         
-        // 处理键盘事件（按ESC退出）
-        if (waitKey(1) == 27) {
+        if (key == 27) {
             done = true;
             break;
         }
-        
-        // 避免过度占用CPU
-//        this_thread::sleep_for(chrono::milliseconds(1));
     }
     
     destroyAllWindows();
 }
 
-int main() {
+static void usage(const char* prog) {
+    fprintf(stderr, "用法: %s [-t 秒数] [-s 宽x高] [-f 预览帧率上限] [-H 端口 [-b 地址]] [-N]\n"
+                    "  预览默认 %dx%d、最高 %d FPS，按原图比例缩放\n"
+                    "  -H 启动 MJPEG-over-HTTP 预览（/stream 原始帧，/preview 预览帧），默认只监听 127.0.0.1\n"
+                    "  -N 不开窗口，只通过 HTTP 查看\n",
+            prog, PREVIEW_WIDTH, PREVIEW_HEIGHT, PREVIEW_FPS);
+}
+
+int main(int argc, char** argv) {
+    double duration = 60.0;  // 60秒
+    HttpServerConfig http_config;
+    bool serve_http = false;
+    
+    int opt;
+    while ((opt = getopt(argc, argv, "t:s:f:H:b:Nh")) != -1) {
+        switch (opt) {
+        case 'H':
+            http_config.port = atoi(optarg);
+            serve_http = true;
+            break;
+        case 'b':
+            http_config.bind_addr = optarg;
+            break;
+        case 'N':
+            show_window = false;
+            break;
+        case 't':
+            duration = atof(optarg);
+            break;
+        case 's':
+            if (sscanf(optarg, "%dx%d", &preview.width, &preview.height) != 2 ||
+                preview.width <= 0 || preview.height <= 0) {
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'f':
+            preview.max_fps = atof(optarg);
+            if (preview.max_fps <= 0) {
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (!show_window && !serve_http) {
+        fprintf(stderr, "-N 需要同时指定 -H，否则没有任何预览\n");
+        usage(argv[0]);
+        return -1;
+    }
+    http_config.max_fps = preview.max_fps;
+    if (serve_http && !http.start(http_config)) return -1;
+    
     // 打开摄像头设备
     const char* device = "/dev/video0";
     int fd = v4l2_open(device, O_RDWR | O_NONBLOCK);
@@ -208,10 +384,8 @@ int main() {
         return -1;
     }
     
-    double duration = 60.0;  // 60秒
-    
     printf("开始高分辨率捕获与显示（3264x2448）...\n");
-    printf("按ESC键可提前退出\n");
+    if (show_window) printf("按ESC键可提前退出\n");
     
     struct timeval start_time, end_time;
     gettimeofday(&start_time, NULL);
@@ -219,12 +393,17 @@ int main() {
     // 启动捕获线程
     thread cap_thread(capture_thread, fd, duration);
     
-    // 启动显示线程
-    thread display_thread_obj(display_thread);
+    // 启动预览和显示线程
+    thread preview_thread_obj(preview_thread);
+    thread display_thread_obj;
+    if (show_window) display_thread_obj = thread(display_thread);
     
     // 等待线程完成
     cap_thread.join();
-    display_thread_obj.join();
+    done = true;  // 采集线程出错提前返回时也要让预览和显示线程退出
+    preview_thread_obj.join();
+    if (display_thread_obj.joinable()) display_thread_obj.join();
+    http.stop();
     
     gettimeofday(&end_time, NULL);
     double total_time = (end_time.tv_sec - start_time.tv_sec) + 
@@ -238,8 +417,15 @@ int main() {
     printf("总时长: %.2f 秒\n", total_time);
     printf("捕获帧数: %d\n", frames_captured.load());
     printf("显示帧数: %d\n", frames_displayed.load());
+    printf("预览帧数: %d（每帧解码缩放 %.1f ms）\n", frames_previewed.load(),
+           frames_previewed > 0 ? preview_decode_sec / frames_previewed.load() * 1000 : 0.0);
+    printf("未显示即被新帧覆盖: %d\n", frames_captured.load() - frames_displayed.load());
     printf("平均捕获帧率: %.2f FPS\n", frames_captured.load() / total_time);
     printf("平均显示帧率: %.2f FPS\n", frames_displayed.load() / total_time);
+    if (frames_displayed > 0)
+        printf("采集到显示延迟: 平均 %.1f ms，最大 %.1f ms\n",
+               latency_total_ms / frames_displayed.load(), latency_max_ms);
+    if (serve_http) http.print_summary();
     
     return 0;
 }
@@ -5,27 +5,277 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
-#include <queue>
+#include <condition_variable>
 #include <libv4l2.h>
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
+#include <cstdlib>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include "async_writer.h"
+#include "direct_sink.h"
+#include "frame_gate.h"
+#include "frame_ring.h"
+#include "jpeg_transform.h"
+#include "mjpeg_container.h"
+#include "video_segmenter.h"
 
 using namespace cv;
 using namespace std;
 
-// 直接捕获MJPEG帧的缓冲区
+#define JPEG_POOL_SIZE 16  // 预分配的JPEG缓冲数量，决定最大积压帧数
+#define QUEUE_DEPTH 8      // 默认队列深度，需小于 JPEG_POOL_SIZE
+#define WRITER_THREADS 4   // pwrite 回退后端的线程数
+#define RING_MB 256        // 触发录制模式预录缓冲的默认大小
+#define RING_MAX_FRAMES 4096
+
+// 预分配、按页对齐的JPEG缓冲池，在采集线程和保存线程之间循环使用，
+// 稳定录制时不再为每帧分配内存；池耗尽时丢帧并计数，而不是无限增长内存
+class JpegBufferPool {
+public:
+    ~JpegBufferPool() {
+        for (uchar* p : slots) free(p);
+    }
+
+    // capacity 取自协商后格式的 sizeimage（单帧JPEG的最大长度）
+    bool init(size_t count, size_t capacity) {
+        slot_capacity = (capacity + 4095) & ~size_t(4095);
+        for (size_t i = 0; i < count; ++i) {
+            void* p = nullptr;
+            if (posix_memalign(&p, 4096, slot_capacity) != 0) return false;
+            slots.push_back(static_cast<uchar*>(p));
+        }
+        free_list.reserve(count);
+        for (size_t i = count; i > 0; --i) free_list.push_back(int(i - 1));
+        return true;
+    }
+
+    // 返回空闲缓冲下标，池耗尽时返回 -1
+    int acquire() {
+        lock_guard<mutex> lock(pool_mutex);
+        if (free_list.empty()) {
+            exhausted++;
+            return -1;
+        }
+        int slot = free_list.back();
+        free_list.pop_back();
+        int used = int(slots.size() - free_list.size());
+        if (used > peak_in_use) peak_in_use = used;
+        return slot;
+    }
+
+    void release(int slot) {
+        lock_guard<mutex> lock(pool_mutex);
+        free_list.push_back(slot);
+    }
+
+    uchar* data(int slot) const { return slots[slot]; }
+    uchar* const* all() const { return slots.data(); }
+    size_t capacity() const { return slot_capacity; }
+    size_t size() const { return slots.size(); }
+
+    atomic<int> exhausted{0};
+    atomic<int> oversized{0};   // 帧比缓冲大（超过协商的 sizeimage）而丢弃
+    int peak_in_use = 0;
+
+private:
+    vector<uchar*> slots;
+    vector<int> free_list;
+    size_t slot_capacity = 0;
+    mutex pool_mutex;
+};
+
+// 直接捕获MJPEG帧的缓冲区（数据在池中，这里只记录下标和长度）
 struct MJpegBuffer {
-    vector<uchar> data;
+    int slot;
+    size_t size;
     int frame_number;
-    timeval capture_time;
+    uint32_t sequence;      // V4L2 帧序号
+    uint64_t timestamp_ns;  // V4L2 时间戳
+};
+
+// 队列满时的处理策略
+enum class OverflowPolicy {
+    Block,       // 阻塞采集线程直到有空位（不丢帧，但可能丢失驱动侧的帧）
+    DropOldest,  // 丢弃队首最旧的帧
+    DropNewest,  // 丢弃当前新帧
+};
+
+enum class PushResult { Queued, DroppedNewest, EvictedOldest };
+
+// 有界阻塞队列：预分配环形存储，条件变量唤醒消费者，满时按策略处理，
+// 并统计队列深度和消费者唤醒延迟
+template <typename T>
+class BoundedQueue {
+public:
+    void configure(size_t capacity, OverflowPolicy overflow) {
+        ring.resize(capacity);
+        policy = overflow;
+    }
+
+    // DropOldest 时被挤出的元素写入 evicted，调用方负责归还其资源
+    PushResult push(const T& item, T* evicted) {
+        unique_lock<mutex> lock(m);
+        PushResult result = PushResult::Queued;
+        if (count == ring.size()) {
+            if (policy == OverflowPolicy::DropNewest) {
+                dropped++;
+                return PushResult::DroppedNewest;
+            }
+            if (policy == OverflowPolicy::DropOldest) {
+                *evicted = ring[head];
+                head = (head + 1) % ring.size();
+                count--;
+                dropped++;
+                result = PushResult::EvictedOldest;
+            } else {
+                auto t0 = chrono::steady_clock::now();
+                not_full.wait(lock, [this] { return count < ring.size() || closed; });
+                producer_blocked_sec += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+                if (closed) return PushResult::DroppedNewest;
+            }
+        }
+        ring[(head + count) % ring.size()] = item;
+        count++;
+        depth_sum += count;
+        depth_samples++;
+        if (count > max_depth) max_depth = count;
+        if (consumer_waiting) notify_time = chrono::steady_clock::now();
+        lock.unlock();
+        not_empty.notify_one();
+        return result;
+    }
+
+    // 阻塞直到取到元素；队列关闭且为空时返回 false
+    bool pop(T& out) {
+        unique_lock<mutex> lock(m);
+        if (count == 0 && !closed) {
+            consumer_waiting = true;
+            not_empty.wait(lock, [this] { return count > 0 || closed; });
+            consumer_waiting = false;
+            if (count > 0) {
+                double latency = chrono::duration<double>(chrono::steady_clock::now() - notify_time).count();
+                wakeup_sum_sec += latency;
+                wakeup_count++;
+                if (latency > wakeup_max_sec) wakeup_max_sec = latency;
+            }
+        }
+        if (count == 0) return false;
+        take(out, lock);
+        return true;
+    }
+
+    // 不阻塞，队列为空时立即返回 false
+    bool try_pop(T& out) {
+        unique_lock<mutex> lock(m);
+        if (count == 0) return false;
+        take(out, lock);
+        return true;
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> lock(m);
+            closed = true;
+        }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    void print_metrics() {
+        lock_guard<mutex> lock(m);
+        printf("队列: 深度上限 %zu，峰值 %zu，平均 %.2f，溢出丢帧 %d\n", ring.size(), max_depth,
+               depth_samples ? double(depth_sum) / depth_samples : 0.0, dropped);
+        printf("采集线程阻塞: %.3f 秒，保存线程唤醒延迟: 平均 %.1f us，最大 %.1f us\n",
+               producer_blocked_sec,
+               wakeup_count ? wakeup_sum_sec / wakeup_count * 1e6 : 0.0, wakeup_max_sec * 1e6);
+    }
+
+private:
+    void take(T& out, unique_lock<mutex>& lock) {
+        out = ring[head];
+        head = (head + 1) % ring.size();
+        count--;
+        lock.unlock();
+        not_full.notify_one();
+    }
+
+    vector<T> ring;
+    size_t head = 0;
+    size_t count = 0;
+    bool closed = false;
+    OverflowPolicy policy = OverflowPolicy::Block;
+    mutex m;
+    condition_variable not_empty;
+    condition_variable not_full;
+
+    bool consumer_waiting = false;
+    chrono::steady_clock::time_point notify_time;
+    size_t max_depth = 0;
+    uint64_t depth_sum = 0;
+    uint64_t depth_samples = 0;
+    int dropped = 0;
+    double producer_blocked_sec = 0;
+    double wakeup_sum_sec = 0;
+    double wakeup_max_sec = 0;
+    uint64_t wakeup_count = 0;
 };
 
 // 全局变量
-queue<MJpegBuffer> frame_queue;
-mutex queue_mutex;
+JpegBufferPool jpeg_pool;
+BoundedQueue<MJpegBuffer> frame_queue;
 atomic<bool> done(false);
 atomic<int> frames_saved(0);
 atomic<int> frames_captured(0);
+int frame_width = 0;   // 协商后的分辨率，采集线程在第一帧入队前写入
+int frame_height = 0;
+double frame_rate = 0; // 驱动报告的帧率，未知时为 0
+atomic<bool> stop_requested(false);
+atomic<int> trigger_requests(0);
+
+// 录制文件的存储方式
+struct StorageConfig {
+    bool buffered = false;       // true 时用普通带缓冲写入，默认 O_DIRECT
+    uint64_t segment_bytes = 0;  // 分段大小，0 表示不分段；同时作为每个文件的预分配大小
+};
+StorageConfig storage;
+DirectSinkStats direct_stats;
+
+// 可选的存储前无损裁剪/旋转（-c/-x）：在 DCT 域变换后写回原缓冲，只在保存线程中使用
+struct StoreTransform {
+    bool enabled = false;
+    JpegTransform transform;
+    JpegTransformer transformer;
+    vector<uint8_t> out;
+    uint64_t frames = 0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    int failed = 0;
+    double sec = 0;
+
+    // 存储的分辨率：变换过至少一帧后取变换结果的尺寸
+    int width() const { return frames ? transformer.width() : frame_width; }
+    int height() const { return frames ? transformer.height() : frame_height; }
+
+    void print_summary() const {
+        printf("存储前变换: %llu 帧，每帧 %.1f ms，%.1f MB -> %.1f MB，失败 %d（保留原帧）\n",
+               (unsigned long long)frames, frames ? sec / frames * 1000 : 0.0,
+               bytes_in / (1024.0 * 1024.0), bytes_out / (1024.0 * 1024.0), failed);
+    }
+};
+StoreTransform store_transform;
+
+// 触发一次事件录制（保存预录帧并继续录制后录时长），可在任意线程调用。
+// 外部进程（OCR 检测到数字变化、串口消息、I2C 传感器越限等）可以发送 SIGUSR1 触发
+void request_trigger() {
+    trigger_requests++;
+}
+
+static void handle_signal(int sig) {
+    if (sig == SIGUSR1) request_trigger();
+    else stop_requested = true;
+}
 
 // 直接捕获MJPEG帧的线程
 void capture_mjpeg_thread(int fd, double duration) {
@@ -41,8 +291,25 @@ void capture_mjpeg_thread(int fd, double duration) {
     
     if (ioctl(fd, VIDIOC_S_FMT, &fmt) < 0) {
         perror("设置MJPEG格式失败");
+        done = true;
         return;
     }
+    frame_width = fmt.fmt.pix.width;
+    frame_height = fmt.fmt.pix.height;
+    struct v4l2_streamparm parm = {};
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (ioctl(fd, VIDIOC_G_PARM, &parm) == 0 && parm.parm.capture.timeperframe.numerator)
+        frame_rate = double(parm.parm.capture.timeperframe.denominator) / parm.parm.capture.timeperframe.numerator;
+    
+    // 按驱动给出的单帧最大长度预分配缓冲池
+    size_t max_jpeg_size = fmt.fmt.pix.sizeimage;
+    if (max_jpeg_size == 0) max_jpeg_size = size_t(fmt.fmt.pix.width) * fmt.fmt.pix.height * 2;
+    if (!jpeg_pool.init(JPEG_POOL_SIZE, max_jpeg_size)) {
+        fprintf(stderr, "分配JPEG缓冲池失败\n");
+        done = true;
+        return;
+    }
+    printf("JPEG缓冲池: %zu x %.2f MB\n", jpeg_pool.size(), jpeg_pool.capacity() / (1024.0 * 1024.0));
     
     // 分配缓冲区
     struct v4l2_requestbuffers req = {};
@@ -98,7 +365,7 @@ void capture_mjpeg_thread(int fd, double duration) {
         gettimeofday(&current_time, NULL);
         double elapsed = (current_time.tv_sec - start_time.tv_sec) + 
                         (current_time.tv_usec - start_time.tv_usec) / 1000000.0;
-        if (elapsed >= duration) break;
+        if (stop_requested || (duration > 0 && elapsed >= duration)) break;
         
         // 出队缓冲区
         v4l2_buffer buf = {};
@@ -110,21 +377,38 @@ void capture_mjpeg_thread(int fd, double duration) {
             continue;
         }
         
-        // 获取帧数据
-        MJpegBuffer mjpeg;
-        uchar* src = reinterpret_cast<uchar*>(buf.m.userptr);
-        mjpeg.data.assign(src, src + buf.bytesused);
-        mjpeg.frame_number = frame_count;
-        gettimeofday(&mjpeg.capture_time, NULL);
-        
-        // 添加到队列
-        {
-            lock_guard<mutex> lock(queue_mutex);
-            frame_queue.push(move(mjpeg));
+        // 获取帧数据：拷贝到池中的空闲缓冲，池耗尽（保存跟不上）时丢弃该帧
+        int slot = jpeg_pool.acquire();
+        if (slot >= 0 && buf.bytesused <= jpeg_pool.capacity()) {
+            uchar* src = reinterpret_cast<uchar*>(buffers[buf.index].m.userptr);
+            memcpy(jpeg_pool.data(slot), src, buf.bytesused);
+            
+            MJpegBuffer mjpeg;
+            mjpeg.slot = slot;
+            mjpeg.size = buf.bytesused;
+            mjpeg.frame_number = frame_count;
+            mjpeg.sequence = buf.sequence;
+            mjpeg.timestamp_ns = uint64_t(buf.timestamp.tv_sec) * 1000000000ull + buf.timestamp.tv_usec * 1000ull;
+            
+            // 添加到队列，队列满时按策略阻塞或丢帧
+            MJpegBuffer evicted;
+            switch (frame_queue.push(mjpeg, &evicted)) {
+            case PushResult::Queued:
+                break;
+            case PushResult::DroppedNewest:
+                jpeg_pool.release(mjpeg.slot);
+                break;
+            case PushResult::EvictedOldest:
+                jpeg_pool.release(evicted.slot);
+                break;
+            }
+            frames_captured++;
+        } else if (slot >= 0) {
+            jpeg_pool.oversized++;
+            jpeg_pool.release(slot);
         }
         
         frame_count++;
-        frames_captured++;
         
         // 重新入队缓冲区
         if (ioctl(fd, VIDIOC_QBUF, &buf) < 0) {
@@ -144,41 +428,373 @@ void capture_mjpeg_thread(int fd, double duration) {
     done = true;
 }
 
-// 保存线程
-void save_thread() {
-    while (!done || !frame_queue.empty()) {
+// 各保存线程取到帧后先调用：启用了存储前变换时用变换结果替换池中的帧
+static void transform_for_store(MJpegBuffer& mjpeg) {
+    StoreTransform& st = store_transform;
+    if (!st.enabled) return;
+    auto t0 = chrono::steady_clock::now();
+    bool ok = st.transformer.apply(jpeg_pool.data(mjpeg.slot), mjpeg.size, st.transform, st.out) &&
+              st.out.size() <= jpeg_pool.capacity();
+    st.sec += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    if (!ok) {
+        if (st.failed++ == 0) fprintf(stderr, "存储前变换失败: %s\n", st.transformer.error());
+        return;
+    }
+    memcpy(jpeg_pool.data(mjpeg.slot), st.out.data(), st.out.size());
+    st.bytes_in += mjpeg.size;
+    st.bytes_out += st.out.size();
+    st.frames++;
+    mjpeg.size = st.out.size();
+}
+
+// 写盘完成回调（在写盘后端线程中执行）：归还缓冲
+static void on_frame_written(int slot, ssize_t result, void*) {
+    jpeg_pool.release(slot);
+    if (result >= 0) frames_saved++;
+}
+
+// 按帧写文件模式的保存线程：只负责把帧交给异步写盘后端，队列取空时才真正提交，
+// 使连续到达的帧合并为一次提交；队列关闭且取空后等待在途写完成再退出
+void save_files_thread(WriterBackend backend, const char* dir, unique_ptr<FrameWriter>* out_writer) {
+    MJpegBuffer mjpeg;
+    unique_ptr<FrameWriter> writer;
+    for (;;) {
+        if (!frame_queue.try_pop(mjpeg)) {
+            // 队列已空：先把攒下的请求提交给内核，再阻塞等待下一帧
+            if (writer) writer->submit();
+            if (!frame_queue.pop(mjpeg)) break;
+        }
+        transform_for_store(mjpeg);
+
+        // 缓冲池在采集线程协商格式后才分配，第一帧到达时再创建后端并注册缓冲
+        if (!writer) {
+            writer = make_frame_writer(backend, int(jpeg_pool.size()), on_frame_written, nullptr,
+                                       jpeg_pool.all(), jpeg_pool.capacity(), WRITER_THREADS);
+            printf("写盘后端: %s\n", writer->name());
+        }
+
+        char filename[256];
+        snprintf(filename, sizeof(filename), "%s/frame_%08d.jpg", dir, mjpeg.frame_number);
+        writer->write_file(filename, mjpeg.slot, jpeg_pool.data(mjpeg.slot), mjpeg.size);
+    }
+    if (writer) writer->drain();
+    *out_writer = std::move(writer);
+}
+
+static bool open_recording(MjcWriter& mjc, const char* path) {
+    int w = store_transform.width();
+    int h = store_transform.height();
+    if (storage.buffered) return mjc.open(path, w, h, V4L2_PIX_FMT_MJPEG);
+    unique_ptr<DirectSink> sink(new DirectSink);
+    if (!sink->open(path, storage.segment_bytes, &direct_stats)) return false;
+    return mjc.open(std::move(sink), w, h, V4L2_PIX_FMT_MJPEG);
+}
+
+// 分段文件名：capture.mjc -> capture_000.mjc
+static string segment_path(const char* path, int n) {
+    string p = path;
+    size_t dot = p.rfind('.');
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%03d", n);
+    return dot == string::npos ? p + suffix : p.substr(0, dot) + suffix + p.substr(dot);
+}
+
+// 容器模式的保存线程：所有帧顺序追加到 .mjc 文件，设置了分段大小时写满一段换下一个文件。
+// gate 非空时先做帧差判断，未变化的帧只在容器中记下时间戳
+void save_container_thread(const char* path, MjcWriter* mjc, FrameGate* gate) {
+    MJpegBuffer mjpeg;
+    bool opened = false;
+    bool failed = false;
+    int segment = 0;
+    while (frame_queue.pop(mjpeg)) {
+        transform_for_store(mjpeg);
+        if (opened && storage.segment_bytes && mjc->file_size() >= storage.segment_bytes) {
+            if (!mjc->close()) perror("关闭录制文件失败");
+            opened = false;
+            segment++;
+        }
+        // 分辨率在采集线程协商格式后才确定，第一帧到达时再创建文件
+        if (!opened && !failed) {
+            string name = storage.segment_bytes ? segment_path(path, segment) : string(path);
+            opened = open_recording(*mjc, name.c_str());
+            failed = !opened;
+            if (opened && storage.segment_bytes) printf("开始分段 %s\n", name.c_str());
+        }
+        const uint8_t* data = jpeg_pool.data(mjpeg.slot);
+        double score = 0;
+        if (opened && gate && !gate->should_store(data, mjpeg.size, mjpeg.timestamp_ns, &score))
+            mjc->skip_frame(mjpeg.sequence, mjpeg.timestamp_ns, score);
+        else if (opened && mjc->write_frame(data, mjpeg.size, mjpeg.sequence, mjpeg.timestamp_ns))
+            frames_saved++;
+        jpeg_pool.release(mjpeg.slot);
+    }
+    if (opened && !mjc->close())
+        perror("关闭录制文件失败");
+}
+
+// 压缩视频模式的保存线程：帧交给编码线程后立即归还缓冲，编码跟不上时由分段器丢帧和降级，
+// 不会反压到采集线程
+void save_video_thread(const SegmenterConfig* cfg, VideoSegmenter* video) {
+    MJpegBuffer mjpeg;
+    bool started = false;
+    while (frame_queue.pop(mjpeg)) {
+        transform_for_store(mjpeg);
+        if (!started) started = video->start(*cfg, store_transform.width(), store_transform.height(), frame_rate);
+        video->offer(jpeg_pool.data(mjpeg.slot), mjpeg.size, mjpeg.timestamp_ns);
+        jpeg_pool.release(mjpeg.slot);
+    }
+    video->stop();
+    frames_saved = int(video->encoded_frames());
+}
+
+// 触发录制配置
+struct TriggerConfig {
+    double pre_sec = 0;     // 预录时长，0 表示不启用触发录制
+    double post_sec = 5;    // 最后一次触发之后继续录制的时长
+    size_t ring_mb = RING_MB;
+};
+
+// 触发录制模式的保存线程：平时帧只进入固定大小的预录缓冲；触发后新建一个 .mjc，
+// 先写入预录帧，再直接写入后续帧，直到最后一次触发之后 post_sec 秒
+void save_trigger_thread(const TriggerConfig* cfg) {
+    FrameRing ring;
+    if (!ring.init(cfg->ring_mb << 20, RING_MAX_FRAMES)) {
+        fprintf(stderr, "分配预录缓冲失败\n");
         MJpegBuffer mjpeg;
-        bool has_frame = false;
-        
-        // 从队列获取帧
-        {
-            lock_guard<mutex> lock(queue_mutex);
-            if (!frame_queue.empty()) {
-                mjpeg = move(frame_queue.front());
-                frame_queue.pop();
-                has_frame = true;
+        while (frame_queue.pop(mjpeg)) jpeg_pool.release(mjpeg.slot);
+        return;
+    }
+    const uint64_t pre_ns = uint64_t(cfg->pre_sec * 1e9);
+    const uint64_t post_ns = uint64_t(cfg->post_sec * 1e9);
+
+    MjcWriter mjc;
+    bool recording = false;
+    uint64_t record_until = 0;
+    int seen = trigger_requests.load();
+    int events = 0;
+    uint64_t event_start = 0;
+
+    MJpegBuffer mjpeg;
+    while (frame_queue.pop(mjpeg)) {
+        transform_for_store(mjpeg);
+        const uint8_t* data = jpeg_pool.data(mjpeg.slot);
+
+        int requests = trigger_requests.load();
+        if (requests != seen) {
+            seen = requests;
+            if (!recording) {
+                char path[64];
+                time_t now = time(nullptr);
+                size_t len = strftime(path, sizeof(path), "event_%Y%m%d_%H%M%S", localtime(&now));
+                snprintf(path + len, sizeof(path) - len, "_%03d.mjc", ++events);
+                recording = open_recording(mjc, path);
+                if (recording) {
+                    event_start = mjc.frame_count();
+                    printf("触发 #%d: 写入 %s，预录 %zu 帧（%.1f 秒）\n", events, path,
+                           ring.count(), ring.span_sec());
+                    for (size_t i = 0; i < ring.count(); ++i) {
+                        const FrameRing::Entry& e = ring.at(i);
+                        if (mjc.write_frame(ring.data(e), e.size, e.sequence, e.timestamp_ns))
+                            frames_saved++;
+                    }
+                    ring.clear();
+                }
             }
+            // 录制中再次触发则延长后录
+            record_until = mjpeg.timestamp_ns + post_ns;
         }
-        
-        if (has_frame) {
-            // 直接保存MJPEG数据
-            char filename[100];
-            sprintf(filename, "/dev/shm/captured_frames/frame_%04d.jpg", mjpeg.frame_number);
-            
-            ofstream file(filename, ios::binary);
-            file.write(reinterpret_cast<const char*>(mjpeg.data.data()), mjpeg.data.size());
-            
-            frames_saved++;
+
+        if (recording) {
+            if (mjc.write_frame(data, mjpeg.size, mjpeg.sequence, mjpeg.timestamp_ns))
+                frames_saved++;
+            if (mjpeg.timestamp_ns >= record_until) {
+                mjc.close();
+                recording = false;
+                printf("触发 #%d: 录制结束，共 %llu 帧\n", events, (unsigned long long)(mjc.frame_count() - event_start));
+            }
         } else {
-            // 队列为空时短暂休眠
-            this_thread::sleep_for(chrono::milliseconds(10));
+            ring.push(data, mjpeg.size, mjpeg.sequence, mjpeg.timestamp_ns);
+            if (mjpeg.timestamp_ns > pre_ns) ring.trim_before(mjpeg.timestamp_ns - pre_ns);
         }
+        jpeg_pool.release(mjpeg.slot);
     }
+    if (recording) mjc.close();
+
+    printf("触发录制: %d 次事件，预录缓冲 %zu MB，结束时缓存 %zu 帧（%.1f 秒）\n",
+           events, ring.size_bytes() >> 20, ring.count(), ring.span_sec());
 }
 
-int main() {
-    // 创建内存文件系统目录
-    system("mkdir -p /dev/shm/captured_frames");
+static void usage(const char* prog) {
+    fprintf(stderr, "用法: %s [-t 秒数] [-q 队列深度] [-p block|drop-oldest|drop-newest]\n"
+                    "          [-o 录制文件.mjc | -d 目录 [-w auto|uring|pwrite] | -T 预录秒[,后录秒] [-R 缓冲MB]]\n"
+                    "          [-S 分段MB] [-B] [-g 差异阈值 [-K 关键帧间隔秒]]\n"
+                    "          [-V h264|mjpeg [-L 分段秒] [-r 1|2|4|8] [-C 核心,核心...]]\n"
+                    "          [-c x,y,w,h] [-x hflip|vflip|rot90|rot180|rot270|transpose|transverse]\n"
+                    "  默认写入 capture_<日期>_<时间>.mjc；-d 时每帧一个 JPEG 文件\n"
+                    "  -T 只在触发时录制（kill -USR1 <pid>），保存触发前后的帧到 event_*.mjc\n"
+                    "  录制文件默认以 O_DIRECT 直接写入存储，-B 改用普通带缓冲写入；\n"
+                    "  -S 每个文件写到指定大小后换下一个分段，并按分段大小预分配\n"
+                    "  -g 连续录制时只保存与上一关键帧平均灰度差（0~255）不小于阈值的帧，例如 -g 2；\n"
+                    "     画面不变时至少每 -K 秒（默认 10）保存一帧，跳过的帧在录制文件中留有时间戳\n"
+                    "  -V 压缩视频模式，按 -L 秒（默认 600）分段写入 video_*.mp4/.avi（-o 可指定前缀），\n"
+                    "     以 1/-r（默认 2）分辨率编码，编码线程绑定到 -C 指定的核心；编码跟不上时自动降级\n"
+                    "  -c/-x 保存前在 DCT 域无损裁剪（起点按 MCU 对齐）和旋转/翻转，减小每帧大小\n"
+                    "  -t 0 表示一直录制到 Ctrl+C\n", prog);
+}
+
+int main(int argc, char** argv) {
+    double duration = 60.0;  // 60秒
+    size_t queue_depth = QUEUE_DEPTH;
+    OverflowPolicy policy = OverflowPolicy::Block;
+    WriterBackend backend = WriterBackend::Auto;
+    const char* frame_dir = nullptr;
+    char container_path[256] = "";
+    TriggerConfig trigger;
+    double gate_threshold = 0;
+    double keyframe_interval = 10.0;
+    SegmenterConfig video_cfg;
+    bool video_mode = false;
+    
+    int opt;
+    while ((opt = getopt(argc, argv, "t:q:p:w:o:d:T:R:S:Bg:K:V:L:r:C:c:x:h")) != -1) {
+        switch (opt) {
+        case 't':
+            duration = atof(optarg);
+            break;
+        case 'q':
+            queue_depth = strtoul(optarg, nullptr, 10);
+            break;
+        case 'p':
+            if (strcmp(optarg, "block") == 0) policy = OverflowPolicy::Block;
+            else if (strcmp(optarg, "drop-oldest") == 0) policy = OverflowPolicy::DropOldest;
+            else if (strcmp(optarg, "drop-newest") == 0) policy = OverflowPolicy::DropNewest;
+            else {
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'w':
+            if (strcmp(optarg, "auto") == 0) backend = WriterBackend::Auto;
+            else if (strcmp(optarg, "uring") == 0) backend = WriterBackend::IoUring;
+            else if (strcmp(optarg, "pwrite") == 0) backend = WriterBackend::ThreadPool;
+            else {
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'o':
+            snprintf(container_path, sizeof(container_path), "%s", optarg);
+            break;
+        case 'd':
+            frame_dir = optarg;
+            break;
+        case 'T': {
+            char* end;
+            trigger.pre_sec = strtod(optarg, &end);
+            if (*end == ',') trigger.post_sec = atof(end + 1);
+            if (trigger.pre_sec <= 0) {
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        }
+        case 'R': {
+            char* end;
+            trigger.ring_mb = strtoul(optarg, &end, 10);
+            if (trigger.ring_mb == 0 || *end != '\0') {
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        }
+        case 'S':
+            storage.segment_bytes = strtoull(optarg, nullptr, 10) << 20;
+            break;
+        case 'B':
+            storage.buffered = true;
+            break;
+        case 'g':
+            gate_threshold = atof(optarg);
+            break;
+        case 'K':
+            keyframe_interval = atof(optarg);
+            break;
+        case 'V':
+            if (strcmp(optarg, "h264") == 0) video_cfg.codec = VideoCodec::H264;
+            else if (strcmp(optarg, "mjpeg") == 0) video_cfg.codec = VideoCodec::Mjpeg;
+            else {
+                usage(argv[0]);
+                return -1;
+            }
+            video_mode = true;
+            break;
+        case 'L':
+            video_cfg.segment_sec = atof(optarg);
+            break;
+        case 'r':
+            video_cfg.reduce = atoi(optarg);
+            if (video_cfg.reduce != 1 && video_cfg.reduce != 2 && video_cfg.reduce != 4 && video_cfg.reduce != 8) {
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'c':
+            if (sscanf(optarg, "%d,%d,%d,%d", &store_transform.transform.crop_x, &store_transform.transform.crop_y,
+                       &store_transform.transform.crop_w, &store_transform.transform.crop_h) != 4 ||
+                store_transform.transform.crop_x < 0 || store_transform.transform.crop_y < 0 ||
+                store_transform.transform.crop_w < 0 || store_transform.transform.crop_h < 0) {
+                usage(argv[0]);
+                return -1;
+            }
+            store_transform.enabled = true;
+            break;
+        case 'x':
+            if (!parse_jpeg_op(optarg, &store_transform.transform.op)) {
+                usage(argv[0]);
+                return -1;
+            }
+            store_transform.enabled = true;
+            break;
+        case 'C':
+            for (char* p = optarg; *p;) {
+                video_cfg.cpus.push_back(int(strtol(p, &p, 10)));
+                if (*p == ',') p++;
+                else if (*p) {
+                    usage(argv[0]);
+                    return -1;
+                }
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    // 保存线程手上还持有一帧，队列深度必须小于缓冲池大小
+    if (queue_depth < 1 || queue_depth >= JPEG_POOL_SIZE) {
+        fprintf(stderr, "队列深度必须在 1 到 %d 之间\n", JPEG_POOL_SIZE - 1);
+        return -1;
+    }
+    frame_queue.configure(queue_depth, policy);
+    
+    // 直接写入持久存储
+    if (frame_dir) {
+        if (mkdir(frame_dir, 0755) < 0 && errno != EEXIST) {
+            perror("创建输出目录失败");
+            return -1;
+        }
+    } else if (video_mode) {
+        // -o 给出的路径去掉扩展名后作为分段文件名前缀
+        if (container_path[0]) {
+            video_cfg.prefix = container_path;
+            size_t dot = video_cfg.prefix.rfind('.');
+            if (dot != string::npos && video_cfg.prefix.find('/', dot) == string::npos)
+                video_cfg.prefix.erase(dot);
+        }
+    } else if (container_path[0] == '\0' && trigger.pre_sec == 0) {
+        time_t now = time(nullptr);
+        strftime(container_path, sizeof(container_path), "capture_%Y%m%d_%H%M%S.mjc", localtime(&now));
+    }
     
     // 打开摄像头设备
     const char* device = "/dev/video0";
@@ -188,8 +804,8 @@ int main() {
         return -1;
     }
     
-    double duration = 60.0;  // 60秒
-    
+    signal(SIGINT, handle_signal);
+    signal(SIGUSR1, handle_signal);
     printf("开始高分辨率捕获（3264x2448）...\n");
     
     struct timeval start_time, end_time;
@@ -199,10 +815,20 @@ int main() {
     thread cap_thread(capture_mjpeg_thread, fd, duration);
     
     // 启动保存线程
-    thread save_thread1(save_thread);
+    unique_ptr<FrameWriter> writer;
+    MjcWriter mjc;
+    VideoSegmenter video;
+    unique_ptr<FrameGate> gate;
+    if (gate_threshold > 0) gate.reset(new FrameGate(gate_threshold, keyframe_interval));
+    thread save_thread1;
+    if (frame_dir) save_thread1 = thread(save_files_thread, backend, frame_dir, &writer);
+    else if (video_mode) save_thread1 = thread(save_video_thread, &video_cfg, &video);
+    else if (trigger.pre_sec > 0) save_thread1 = thread(save_trigger_thread, &trigger);
+    else save_thread1 = thread(save_container_thread, container_path, &mjc, gate.get());
     
-    // 等待线程完成
+    // 等待线程完成：采集结束后关闭队列，保存线程写完剩余帧后退出
     cap_thread.join();
+    frame_queue.close();
     save_thread1.join();
     
     gettimeofday(&end_time, NULL);
@@ -212,16 +838,29 @@ int main() {
     // 关闭设备
     v4l2_close(fd);
     
-    // 将文件从内存文件系统移动到存储
-    system("mv /dev/shm/captured_frames captured_frames");
-    
     // 输出结果
     printf("\n捕获完成！\n");
     printf("总时长: %.2f 秒\n", total_time);
     printf("捕获帧数: %d\n", frames_captured.load());
     printf("保存帧数: %d\n", frames_saved.load());
     printf("平均帧率: %.2f FPS\n", frames_captured.load() / total_time);
-    printf("图片已保存至: captured_frames/\n");
+    printf("缓冲池峰值占用: %d/%zu，池耗尽丢帧: %d，超出缓冲大小丢帧: %d\n",
+           jpeg_pool.peak_in_use, jpeg_pool.size(), jpeg_pool.exhausted.load(), jpeg_pool.oversized.load());
+    frame_queue.print_metrics();
+    if (store_transform.enabled) store_transform.print_summary();
+    if (frame_dir) {
+        if (writer) writer->stats.print(writer->name(), total_time);
+        printf("图片已保存至: %s/\n", frame_dir);
+    } else if (video_mode) {
+        video.print_summary();
+    } else {
+        if (trigger.pre_sec == 0) {
+            mjc.print_summary(total_time);
+            if (gate) gate->print_summary();
+            printf("录制已保存至: %s\n", container_path);
+        }
+        if (!storage.buffered) direct_stats.print(total_time);
+    }
     
     return 0;
 }
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rawrec.h"
+
+// .yl4 录制文件读取工具
+// 用法: rawplay <文件.yl4>                  列出帧信息
+//       rawplay <文件.yl4> <帧号> [输出.yuv]  解压单帧
+//       rawplay <文件.yl4> -                  按顺序解压全部帧到 stdout，例如：
+//         rawplay rec.yl4 - | ffplay -f rawvideo -pixel_format yuyv422 -video_size 3264x2448 -
+// 编译: gcc -O3 rawplay.c -o rawplay -llz4 -lpthread
+
+static void print_info(const struct rawrec_reader *r, const char *path) {
+    const struct rawrec_file_hdr *h = &r->hdr;
+    printf("%s: %ux%u %c%c%c%c, %llu frames%s\n", path, h->width, h->height,
+           h->pixelformat & 0xFF, (h->pixelformat >> 8) & 0xFF,
+           (h->pixelformat >> 16) & 0xFF, (h->pixelformat >> 24) & 0xFF,
+           (unsigned long long)r->frame_count,
+           r->recovered ? " (index rebuilt, recording was not closed cleanly)" : "");
+
+    if (r->frame_count == 0) return;
+    double span = (r->index[r->frame_count - 1].timestamp_ns - r->index[0].timestamp_ns) / 1e9;
+    if (span > 0)
+        printf("Duration: %.2f s (%.2f FPS)\n", span, (r->frame_count - 1) / span);
+
+    for (uint64_t i = 0; i < r->frame_count; i++) {
+        const struct rawrec_index_entry *e = &r->index[i];
+        printf("  #%llu seq=%u t=%.3f s raw=%u offset=%llu\n",
+               (unsigned long long)i, e->sequence,
+               (e->timestamp_ns - r->index[0].timestamp_ns) / 1e9,
+               e->raw_size, (unsigned long long)e->offset);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file.yl4> [frame|-] [output.yuv]\n", argv[0]);
+        return 1;
+    }
+
+    struct rawrec_reader r;
+    if (rawrec_reader_open(&r, argv[1]) != 0)
+        return 1;
+
+    if (argc == 2) {
+        print_info(&r, argv[1]);
+        rawrec_reader_close(&r);
+        return 0;
+    }
+
+    size_t frame_cap = (size_t)r.hdr.width * r.hdr.height * 2;
+    uint8_t *frame = malloc(frame_cap);
+    if (!frame) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    int ret = 0;
+    if (strcmp(argv[2], "-") == 0) {
+        for (uint64_t i = 0; i < r.frame_count; i++) {
+            long n = rawrec_read_frame(&r, i, frame, frame_cap);
+            if (n < 0) {
+                fprintf(stderr, "Frame %llu is corrupt\n", (unsigned long long)i);
+                ret = 1;
+                break;
+            }
+            if (fwrite(frame, 1, n, stdout) != (size_t)n) {
+                ret = 1;
+                break;
+            }
+        }
+    } else {
+        uint64_t i = strtoull(argv[2], NULL, 10);
+        long n = rawrec_read_frame(&r, i, frame, frame_cap);
+        if (n < 0) {
+            fprintf(stderr, "Cannot read frame %llu (recording has %llu frames)\n",
+                    (unsigned long long)i, (unsigned long long)r.frame_count);
+            ret = 1;
+        } else {
+            char filename[64];
+            const char *out = argc > 3 ? argv[3] : filename;
+            snprintf(filename, sizeof(filename), "frame_%ux%u_%llu.yuv",
+                     r.hdr.width, r.hdr.height, (unsigned long long)i);
+
+            FILE *fp = fopen(out, "wb");
+            if (!fp || fwrite(frame, 1, n, fp) != (size_t)n) {
+                perror("Cannot write frame");
+                ret = 1;
+            } else {
+                printf("Saved frame %llu to %s (%ld bytes)\n", (unsigned long long)i, out, n);
+            }
+            if (fp) fclose(fp);
+        }
+    }
+
+    free(frame);
+    rawrec_reader_close(&r);
+    return ret;
+}
@@ -0,0 +1,656 @@
+#ifndef RAWREC_H
+#define RAWREC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <lz4.h>
+
+// LZ4 压缩的原始帧录制文件（.yl4），编译需 -llz4 -lpthread
+//
+// 文件布局（小端）：
+//   rawrec_file_hdr
+//   帧记录 * N：rawrec_frame_hdr + uint32 chunk_sizes[n_chunks] + 各分块数据
+//   索引：rawrec_index_entry * N
+//   rawrec_footer
+// 每帧按 chunk_size 切块，由多个线程并行压缩；不可压缩的分块原样存储，
+// 其 chunk_size 最高位置 1。footer 缺失（录制中途断电等）时读取端顺序扫描帧记录重建索引。
+
+#define RAWREC_MAGIC        "YUYVLZ4"
+#define RAWREC_VERSION      1
+#define RAWREC_FRAME_MAGIC  0x304d5246u   // "FRM0"
+#define RAWREC_FOOTER_MAGIC 0x58444952u   // "RIDX"
+#define RAWREC_CHUNK_SIZE   (1024 * 1024)
+#define RAWREC_CHUNK_RAW    0x80000000u
+#define RAWREC_MAX_THREADS  8
+#define RAWREC_MAX_FRAME    (128u * 1024 * 1024)   // 读取端接受的最大单帧原始大小
+#define RAWREC_MIN_CHUNK    4096u
+
+struct rawrec_file_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixelformat;     // V4L2 fourcc
+    uint32_t chunk_size;
+    uint32_t reserved[9];
+};
+
+struct rawrec_frame_hdr {
+    uint32_t magic;
+    uint32_t n_chunks;
+    uint32_t raw_size;
+    uint32_t sequence;
+    uint64_t timestamp_ns;
+    uint64_t payload_size;    // 分块大小表 + 分块数据
+};
+
+struct rawrec_index_entry {
+    uint64_t offset;          // 帧记录在文件中的偏移
+    uint64_t timestamp_ns;
+    uint32_t sequence;
+    uint32_t raw_size;
+};
+
+struct rawrec_footer {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t index_offset;
+    uint64_t frame_count;
+};
+
+static inline uint64_t rawrec_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline int rawrec_write_all(int fd, const void *data, size_t size) {
+    const uint8_t *p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static inline int rawrec_read_at(int fd, void *data, size_t size, uint64_t offset) {
+    uint8_t *p = data;
+    while (size > 0) {
+        ssize_t n = pread(fd, p, size, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) return -1;   // 文件被截断
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+// ========================= 写入端 =========================
+// 压缩输出双缓冲：采集线程并行压缩第 N+1 帧时，写盘线程在写第 N 帧，
+// 采集线程只在两块缓冲都还没写完（磁盘持续跟不上）时才等待。
+#define RAWREC_OUT_BUFFERS 2
+
+struct rawrec_out {
+    char **chunk_buf;           // 每个分块一个压缩输出缓冲
+    uint32_t *chunk_len;        // 带 RAWREC_CHUNK_RAW 标志
+    struct iovec *iov;          // 帧头 + 分块表 + 各分块
+    struct rawrec_frame_hdr fh;
+    int ready;                  // 1 表示已压缩完、等待写盘
+};
+
+struct rawrec_writer {
+    int fd;
+    uint64_t offset;
+    struct rawrec_file_hdr hdr;
+
+    int max_chunks;
+    struct rawrec_out out[RAWREC_OUT_BUFFERS];
+    int fill_next;              // 采集线程下一块要填的缓冲
+    int write_next;             // 写盘线程下一块要写的缓冲
+
+    // 当前帧的并行压缩任务
+    pthread_t threads[RAWREC_MAX_THREADS];
+    int n_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    const uint8_t *src;
+    size_t src_size;
+    struct rawrec_out *dst;
+    int n_chunks;
+    int next_chunk;
+    int chunks_done;
+    uint64_t generation;
+    int quit;
+
+    // 写盘线程
+    pthread_t write_thread;
+    int have_write_thread;
+    pthread_cond_t write_cond;  // 有缓冲待写 / 退出
+    pthread_cond_t free_cond;   // 有缓冲写完
+    int write_quit;
+    int write_error;
+
+    // 以下由写盘线程更新，读取须持有 lock（或在 rawrec_close 之后）
+    struct rawrec_index_entry *index;
+    uint64_t frame_count;
+    uint64_t index_cap;
+    uint64_t stored_bytes;
+    double write_time;
+
+    // 以下只在采集线程中使用
+    uint64_t raw_bytes;
+    double compress_time;
+    double wait_time;           // 等待写盘线程腾出缓冲的时间
+    uint64_t sequence_gaps;     // 驱动侧丢帧（sequence 不连续）
+    uint32_t last_sequence;
+    int have_sequence;
+};
+
+static inline void rawrec_compress_chunk(struct rawrec_writer *w, int c) {
+    size_t begin = (size_t)c * w->hdr.chunk_size;
+    size_t len = w->src_size - begin;
+    if (len > w->hdr.chunk_size) len = w->hdr.chunk_size;
+
+    struct rawrec_out *o = w->dst;
+    int n = LZ4_compress_default((const char *)w->src + begin, o->chunk_buf[c],
+                                 (int)len, LZ4_compressBound(w->hdr.chunk_size));
+    if (n <= 0 || (size_t)n >= len) {
+        memcpy(o->chunk_buf[c], w->src + begin, len);
+        o->chunk_len[c] = (uint32_t)len | RAWREC_CHUNK_RAW;
+    } else {
+        o->chunk_len[c] = (uint32_t)n;
+    }
+}
+
+static inline void *rawrec_worker(void *arg) {
+    struct rawrec_writer *w = arg;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (!w->quit && (w->generation == seen || w->next_chunk >= w->n_chunks))
+            pthread_cond_wait(&w->work_cond, &w->lock);
+        if (w->quit) break;
+        seen = w->generation;
+
+        while (w->next_chunk < w->n_chunks) {
+            int c = w->next_chunk++;
+            pthread_mutex_unlock(&w->lock);
+            rawrec_compress_chunk(w, c);
+            pthread_mutex_lock(&w->lock);
+            if (++w->chunks_done == w->n_chunks)
+                pthread_cond_signal(&w->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+// 写盘线程：帧头、分块表和所有分块一次 writev 写出，再追加索引项
+static inline int rawrec_write_out(struct rawrec_writer *w, struct rawrec_out *o) {
+    int n_iov = 2 + (int)o->fh.n_chunks;
+    struct iovec *iov = o->iov;
+    iov[0].iov_base = &o->fh;
+    iov[0].iov_len = sizeof(o->fh);
+    iov[1].iov_base = o->chunk_len;
+    iov[1].iov_len = o->fh.n_chunks * sizeof(uint32_t);
+    for (uint32_t c = 0; c < o->fh.n_chunks; c++) {
+        iov[2 + c].iov_base = o->chunk_buf[c];
+        iov[2 + c].iov_len = o->chunk_len[c] & ~RAWREC_CHUNK_RAW;
+    }
+
+    uint64_t t0 = rawrec_now_ns();
+    size_t total = sizeof(o->fh) + o->fh.payload_size;
+    size_t done = 0;
+    int iov_start = 0;
+    while (done < total) {
+        ssize_t n = writev(w->fd, iov + iov_start, n_iov - iov_start);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("Error writing recording");
+            return -1;
+        }
+        done += n;
+        // 部分写入时跳过已写完的 iovec
+        while (iov_start < n_iov && (size_t)n >= iov[iov_start].iov_len) {
+            n -= iov[iov_start].iov_len;
+            iov_start++;
+        }
+        if (iov_start < n_iov) {
+            iov[iov_start].iov_base = (uint8_t *)iov[iov_start].iov_base + n;
+            iov[iov_start].iov_len -= n;
+        }
+    }
+    uint64_t t1 = rawrec_now_ns();
+
+    pthread_mutex_lock(&w->lock);
+    if (w->frame_count == w->index_cap) {
+        uint64_t cap = w->index_cap ? w->index_cap * 2 : 1024;
+        struct rawrec_index_entry *idx = realloc(w->index, cap * sizeof(*idx));
+        if (!idx) {
+            pthread_mutex_unlock(&w->lock);
+            fprintf(stderr, "Out of memory for frame index\n");
+            return -1;
+        }
+        w->index = idx;
+        w->index_cap = cap;
+    }
+    struct rawrec_index_entry *e = &w->index[w->frame_count++];
+    e->offset = w->offset;
+    e->timestamp_ns = o->fh.timestamp_ns;
+    e->sequence = o->fh.sequence;
+    e->raw_size = o->fh.raw_size;
+    w->stored_bytes += total;
+    w->write_time += (t1 - t0) / 1e9;
+    pthread_mutex_unlock(&w->lock);
+    w->offset += total;
+    return 0;
+}
+
+static inline void *rawrec_write_thread(void *arg) {
+    struct rawrec_writer *w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        struct rawrec_out *o = &w->out[w->write_next];
+        while (!o->ready && !w->write_quit)
+            pthread_cond_wait(&w->write_cond, &w->lock);
+        if (!o->ready) break;   // 退出前已写完所有待写缓冲
+        pthread_mutex_unlock(&w->lock);
+
+        // 出错后不再写，后面的帧只归还缓冲；采集线程在下一帧看到 write_error
+        int err = w->write_error ? -1 : rawrec_write_out(w, o);
+
+        pthread_mutex_lock(&w->lock);
+        if (err) w->write_error = 1;
+        o->ready = 0;
+        w->write_next = (w->write_next + 1) % RAWREC_OUT_BUFFERS;
+        pthread_cond_signal(&w->free_cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+static inline void rawrec_writer_free(struct rawrec_writer *w) {
+    for (int b = 0; b < RAWREC_OUT_BUFFERS; b++) {
+        struct rawrec_out *o = &w->out[b];
+        if (o->chunk_buf) {
+            for (int i = 0; i < w->max_chunks; i++)
+                free(o->chunk_buf[i]);
+        }
+        free(o->chunk_buf);
+        free(o->chunk_len);
+        free(o->iov);
+        o->chunk_buf = NULL;
+        o->chunk_len = NULL;
+        o->iov = NULL;
+    }
+    free(w->index);
+    w->index = NULL;
+}
+
+static inline void rawrec_stop_threads(struct rawrec_writer *w) {
+    pthread_mutex_lock(&w->lock);
+    w->quit = 1;
+    w->write_quit = 1;
+    pthread_cond_broadcast(&w->work_cond);
+    pthread_cond_signal(&w->write_cond);
+    pthread_mutex_unlock(&w->lock);
+    for (int i = 0; i < w->n_threads; i++)
+        pthread_join(w->threads[i], NULL);
+    if (w->have_write_thread)
+        pthread_join(w->write_thread, NULL);
+}
+
+// 创建录制文件；max_frame_size 决定预分配的压缩缓冲，成功返回 0
+static inline int rawrec_open(struct rawrec_writer *w, const char *path,
+                              uint32_t width, uint32_t height, uint32_t pixelformat,
+                              size_t max_frame_size, int n_threads) {
+    memset(w, 0, sizeof(*w));
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) {
+        perror("Cannot create recording");
+        return -1;
+    }
+
+    memcpy(w->hdr.magic, RAWREC_MAGIC, sizeof(RAWREC_MAGIC));
+    w->hdr.version = RAWREC_VERSION;
+    w->hdr.width = width;
+    w->hdr.height = height;
+    w->hdr.pixelformat = pixelformat;
+    w->hdr.chunk_size = RAWREC_CHUNK_SIZE;
+
+    w->max_chunks = (int)((max_frame_size + RAWREC_CHUNK_SIZE - 1) / RAWREC_CHUNK_SIZE);
+    for (int b = 0; b < RAWREC_OUT_BUFFERS; b++) {
+        struct rawrec_out *o = &w->out[b];
+        o->chunk_buf = calloc(w->max_chunks, sizeof(char *));
+        o->chunk_len = calloc(w->max_chunks, sizeof(uint32_t));
+        o->iov = calloc(w->max_chunks + 2, sizeof(struct iovec));
+        if (!o->chunk_buf || !o->chunk_len || !o->iov)
+            goto fail;
+        for (int i = 0; i < w->max_chunks; i++) {
+            o->chunk_buf[i] = malloc(LZ4_compressBound(RAWREC_CHUNK_SIZE));
+            if (!o->chunk_buf[i])
+                goto fail;
+        }
+    }
+
+    if (rawrec_write_all(w->fd, &w->hdr, sizeof(w->hdr)) < 0) {
+        perror("Cannot write recording header");
+        goto fail;
+    }
+    w->offset = sizeof(w->hdr);
+
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->work_cond, NULL);
+    pthread_cond_init(&w->done_cond, NULL);
+    pthread_cond_init(&w->write_cond, NULL);
+    pthread_cond_init(&w->free_cond, NULL);
+    if (n_threads < 1) n_threads = 1;
+    if (n_threads > RAWREC_MAX_THREADS) n_threads = RAWREC_MAX_THREADS;
+    for (int i = 0; i < n_threads; i++) {
+        if (pthread_create(&w->threads[i], NULL, rawrec_worker, w) != 0)
+            break;
+        w->n_threads++;
+    }
+    w->have_write_thread = pthread_create(&w->write_thread, NULL, rawrec_write_thread, w) == 0;
+    if (w->n_threads == 0 || !w->have_write_thread) {
+        rawrec_stop_threads(w);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    fprintf(stderr, "Cannot initialise recorder\n");
+    rawrec_writer_free(w);
+    close(w->fd);
+    return -1;
+}
+
+// 并行压缩一帧并交给写盘线程；data 可以直接指向 V4L2 mmap 缓冲，返回时已不再引用它。
+// 之前的帧写盘失败时返回 -1
+static inline int rawrec_write_frame(struct rawrec_writer *w, const uint8_t *data, size_t size,
+                                     uint32_t sequence, uint64_t timestamp_ns) {
+    int n_chunks = (int)((size + w->hdr.chunk_size - 1) / w->hdr.chunk_size);
+    if (n_chunks > w->max_chunks || n_chunks == 0) {
+        fprintf(stderr, "Frame size %zu out of range\n", size);
+        return -1;
+    }
+    if (w->have_sequence && (int32_t)(sequence - w->last_sequence) > 1)
+        w->sequence_gaps += sequence - w->last_sequence - 1;
+    w->last_sequence = sequence;
+    w->have_sequence = 1;
+
+    // 等下一块输出缓冲写完
+    struct rawrec_out *o = &w->out[w->fill_next];
+    uint64_t t0 = rawrec_now_ns();
+    pthread_mutex_lock(&w->lock);
+    while (o->ready && !w->write_error)
+        pthread_cond_wait(&w->free_cond, &w->lock);
+    if (w->write_error) {
+        pthread_mutex_unlock(&w->lock);
+        return -1;
+    }
+    uint64_t t1 = rawrec_now_ns();
+
+    w->src = data;
+    w->src_size = size;
+    w->dst = o;
+    w->n_chunks = n_chunks;
+    w->next_chunk = 0;
+    w->chunks_done = 0;
+    w->generation++;
+    pthread_cond_broadcast(&w->work_cond);
+    while (w->chunks_done < n_chunks)
+        pthread_cond_wait(&w->done_cond, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+    uint64_t t2 = rawrec_now_ns();
+
+    memset(&o->fh, 0, sizeof(o->fh));
+    o->fh.magic = RAWREC_FRAME_MAGIC;
+    o->fh.n_chunks = n_chunks;
+    o->fh.raw_size = (uint32_t)size;
+    o->fh.sequence = sequence;
+    o->fh.timestamp_ns = timestamp_ns;
+    o->fh.payload_size = (uint64_t)n_chunks * sizeof(uint32_t);
+    for (int c = 0; c < n_chunks; c++)
+        o->fh.payload_size += o->chunk_len[c] & ~RAWREC_CHUNK_RAW;
+
+    pthread_mutex_lock(&w->lock);
+    o->ready = 1;
+    pthread_cond_signal(&w->write_cond);
+    pthread_mutex_unlock(&w->lock);
+    w->fill_next = (w->fill_next + 1) % RAWREC_OUT_BUFFERS;
+
+    w->raw_bytes += size;
+    w->wait_time += (t1 - t0) / 1e9;
+    w->compress_time += (t2 - t1) / 1e9;
+    return 0;
+}
+
+// 已写入文件的字节数，录制过程中可从采集线程调用
+static inline uint64_t rawrec_stored_bytes(struct rawrec_writer *w) {
+    pthread_mutex_lock(&w->lock);
+    uint64_t n = w->stored_bytes;
+    pthread_mutex_unlock(&w->lock);
+    return n;
+}
+
+// 等待写完剩余的帧，写出索引和 footer，停止线程并关闭文件
+static inline int rawrec_close(struct rawrec_writer *w) {
+    rawrec_stop_threads(w);
+
+    struct rawrec_footer footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.magic = RAWREC_FOOTER_MAGIC;
+    footer.index_offset = w->offset;
+    footer.frame_count = w->frame_count;
+
+    int ret = 0;
+    if (w->write_error) {
+        ret = -1;   // 文件末尾可能是半帧，不写 footer，读取端扫描重建索引
+    } else if (rawrec_write_all(w->fd, w->index, w->frame_count * sizeof(*w->index)) < 0 ||
+               rawrec_write_all(w->fd, &footer, sizeof(footer)) < 0) {
+        perror("Error writing recording index");
+        ret = -1;
+    }
+    if (close(w->fd) < 0)
+        ret = -1;
+
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->work_cond);
+    pthread_cond_destroy(&w->done_cond);
+    pthread_cond_destroy(&w->write_cond);
+    pthread_cond_destroy(&w->free_cond);
+    rawrec_writer_free(w);
+    return ret;
+}
+
+static inline void rawrec_print_summary(const struct rawrec_writer *w) {
+    double raw_mb = w->raw_bytes / (1024.0 * 1024.0);
+    double stored_mb = w->stored_bytes / (1024.0 * 1024.0);
+    printf("Recorder summary (LZ4, %d threads):\n", w->n_threads);
+    printf("  Frames: %llu, raw %.1f MB -> %.1f MB (ratio %.2f:1)\n",
+           (unsigned long long)w->frame_count, raw_mb, stored_mb,
+           stored_mb > 0 ? raw_mb / stored_mb : 0.0);
+    if (w->compress_time > 0 && w->write_time > 0)
+        printf("  Compress %.1f MB/s, write %.1f MB/s\n",
+               raw_mb / w->compress_time, stored_mb / w->write_time);
+    printf("  Waited %.2f s for the disk, driver dropped %llu frames (sequence gaps)\n",
+           w->wait_time, (unsigned long long)w->sequence_gaps);
+}
+
+// ========================= 读取端 =========================
+struct rawrec_reader {
+    int fd;
+    struct rawrec_file_hdr hdr;
+    struct rawrec_index_entry *index;
+    uint64_t frame_count;
+    int recovered;              // 1 表示 footer 缺失，索引由扫描重建
+    char *comp_buf;
+    size_t comp_cap;
+    uint32_t *chunk_sizes;      // 帧记录中的分块大小表，按 max_chunks 申请一次
+    uint32_t max_chunks;
+};
+
+static inline int rawrec_index_push(struct rawrec_reader *r, uint64_t *cap,
+                                    const struct rawrec_index_entry *e) {
+    if (r->frame_count == *cap) {
+        uint64_t n = *cap ? *cap * 2 : 1024;
+        struct rawrec_index_entry *idx = realloc(r->index, n * sizeof(*idx));
+        if (!idx) return -1;
+        r->index = idx;
+        *cap = n;
+    }
+    r->index[r->frame_count++] = *e;
+    return 0;
+}
+
+// 顺序扫描帧记录重建索引，遇到不完整的记录即停止
+static inline int rawrec_scan(struct rawrec_reader *r, uint64_t file_size) {
+    uint64_t cap = 0;
+    uint64_t off = sizeof(r->hdr);
+    struct rawrec_frame_hdr fh;
+
+    while (off + sizeof(fh) <= file_size) {
+        if (rawrec_read_at(r->fd, &fh, sizeof(fh), off) < 0 || fh.magic != RAWREC_FRAME_MAGIC)
+            break;
+        if (off + sizeof(fh) + fh.payload_size > file_size)
+            break;
+        struct rawrec_index_entry e = { off, fh.timestamp_ns, fh.sequence, fh.raw_size };
+        if (rawrec_index_push(r, &cap, &e) < 0)
+            return -1;
+        off += sizeof(fh) + fh.payload_size;
+    }
+    r->recovered = 1;
+    return 0;
+}
+
+static inline int rawrec_reader_open(struct rawrec_reader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    r->fd = open(path, O_RDONLY);
+    if (r->fd < 0) {
+        perror("Cannot open recording");
+        return -1;
+    }
+
+    if (rawrec_read_at(r->fd, &r->hdr, sizeof(r->hdr), 0) < 0 ||
+        memcmp(r->hdr.magic, RAWREC_MAGIC, sizeof(RAWREC_MAGIC)) != 0 ||
+        r->hdr.version != RAWREC_VERSION ||
+        r->hdr.chunk_size < RAWREC_MIN_CHUNK || r->hdr.chunk_size > RAWREC_MAX_FRAME) {
+        fprintf(stderr, "%s: not a raw recording\n", path);
+        close(r->fd);
+        return -1;
+    }
+
+    off_t file_size = lseek(r->fd, 0, SEEK_END);
+    struct rawrec_footer footer;
+    int have_footer = file_size >= (off_t)(sizeof(r->hdr) + sizeof(footer)) &&
+        rawrec_read_at(r->fd, &footer, sizeof(footer), file_size - sizeof(footer)) == 0 &&
+        footer.magic == RAWREC_FOOTER_MAGIC &&
+        footer.index_offset + footer.frame_count * sizeof(struct rawrec_index_entry)
+            + sizeof(footer) == (uint64_t)file_size;
+
+    if (have_footer) {
+        r->frame_count = footer.frame_count;
+        r->index = malloc(footer.frame_count * sizeof(*r->index) + 1);
+        if (!r->index ||
+            rawrec_read_at(r->fd, r->index, footer.frame_count * sizeof(*r->index),
+                           footer.index_offset) < 0) {
+            fprintf(stderr, "Cannot read recording index\n");
+            free(r->index);
+            close(r->fd);
+            return -1;
+        }
+    } else if (rawrec_scan(r, file_size) < 0) {
+        fprintf(stderr, "Out of memory while scanning recording\n");
+        free(r->index);
+        close(r->fd);
+        return -1;
+    }
+
+    r->comp_cap = LZ4_compressBound(r->hdr.chunk_size);
+    r->comp_buf = malloc(r->comp_cap);
+    r->max_chunks = (RAWREC_MAX_FRAME + r->hdr.chunk_size - 1) / r->hdr.chunk_size;
+    r->chunk_sizes = malloc(r->max_chunks * sizeof(uint32_t));
+    if (!r->comp_buf || !r->chunk_sizes) {
+        free(r->comp_buf);
+        free(r->chunk_sizes);
+        free(r->index);
+        close(r->fd);
+        return -1;
+    }
+    return 0;
+}
+
+// 解压第 i 帧到 out，返回原始大小，失败返回 -1
+static inline long rawrec_read_frame(struct rawrec_reader *r, uint64_t i, uint8_t *out, size_t out_cap) {
+    if (i >= r->frame_count) return -1;
+    const struct rawrec_index_entry *e = &r->index[i];
+
+    struct rawrec_frame_hdr fh;
+    if (rawrec_read_at(r->fd, &fh, sizeof(fh), e->offset) < 0 || fh.magic != RAWREC_FRAME_MAGIC)
+        return -1;
+    if (fh.raw_size > out_cap || fh.raw_size > RAWREC_MAX_FRAME) return -1;
+    // 分块数必须与原始大小一致，否则是损坏的记录
+    if (fh.raw_size == 0 ||
+        fh.n_chunks != (fh.raw_size + r->hdr.chunk_size - 1) / r->hdr.chunk_size ||
+        fh.n_chunks > r->max_chunks)
+        return -1;
+
+    uint32_t *sizes = r->chunk_sizes;
+    uint64_t off = e->offset + sizeof(fh);
+    if (rawrec_read_at(r->fd, sizes, fh.n_chunks * sizeof(uint32_t), off) < 0)
+        return -1;
+    off += fh.n_chunks * sizeof(uint32_t);
+
+    size_t produced = 0;
+    for (uint32_t c = 0; c < fh.n_chunks; c++) {
+        uint32_t len = sizes[c] & ~RAWREC_CHUNK_RAW;
+        size_t expect = fh.raw_size - produced;
+        if (expect > r->hdr.chunk_size) expect = r->hdr.chunk_size;
+
+        if (sizes[c] & RAWREC_CHUNK_RAW) {
+            if (len != expect || rawrec_read_at(r->fd, out + produced, len, off) < 0)
+                return -1;
+        } else {
+            if (len > r->comp_cap || rawrec_read_at(r->fd, r->comp_buf, len, off) < 0)
+                return -1;
+            int n = LZ4_decompress_safe(r->comp_buf, (char *)out + produced, (int)len, (int)expect);
+            if (n != (int)expect)
+                return -1;
+        }
+        produced += expect;
+        off += len;
+    }
+    return (long)produced;
+}
+
+static inline void rawrec_reader_close(struct rawrec_reader *r) {
+    free(r->index);
+    free(r->comp_buf);
+    free(r->chunk_sizes);
+    close(r->fd);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+#endif
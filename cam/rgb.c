@@ -9,6 +9,13 @@
 #include <errno.h>
 #include <time.h>
 #include <stdint.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/select.h>
+
+#include "frame_pool.h"
+#include "frame_stats.h"
+#include "frame_writer.h"
 
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
 #define DEVICE_NAME "/dev/video0"
@@ -16,7 +23,10 @@
 #define HEIGHT 1080
 #define PIXEL_FORMAT V4L2_PIX_FMT_RGB24  // RGB24格式
 #define BUFFER_COUNT 4
-#define MAX_FRAMES 3  // 最大保存帧数（高分辨率内存消耗大）
+#define STATS_STEP 2  // 逐帧统计的采样网格间隔
+#define WRITER_THREADS 2  // 后台编码写盘线程数
+#define POOL_SIZE (WRITER_THREADS + 2)  // 循环使用的帧缓冲数量，决定内存上限
+#define REPORT_INTERVAL 30  // 每隔多少帧打印一次统计
 
 // 计算RGB24图像大小
 #define IMAGE_SIZE (WIDTH * HEIGHT * 3)
@@ -26,17 +36,11 @@ struct buffer {
     size_t length;
 };
 
-struct FrameData {
-    uint8_t *data;
-    size_t size;
-    struct timespec timestamp;
-};
-
 static int fd = -1;
 static struct buffer *buffers = NULL;
 static unsigned int n_buffers = 0;
-static struct FrameData frames[MAX_FRAMES];
-static int frame_count = 0;
+static struct frame_pool frame_pool;  // 帧缓冲，采集时直接写入，写盘线程编码后归还
+static volatile sig_atomic_t stop_requested = 0;
 
 void errno_exit(const char *s) {
     fprintf(stderr, "%s error %d, %s\n", s, errno, strerror(errno));
@@ -152,27 +156,37 @@ void start_capturing() {
         errno_exit("VIDIOC_STREAMON");
 }
 
-int read_frame(uint8_t **frame_data, size_t *frame_size) {
-    struct v4l2_buffer buf;
-    CLEAR(buf);
+// 等待并出队一帧，处理完后需调用 requeue_frame 归还给驱动
+int dequeue_frame(struct v4l2_buffer *buf) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    struct timeval tv = { .tv_sec = 2, .tv_usec = 0 };
+    
+    int r = select(fd + 1, &fds, NULL, NULL, &tv);
+    if (r == -1) {
+        if (errno == EINTR) return -1;
+        errno_exit("select");
+    }
+    if (r == 0) {
+        fprintf(stderr, "Timeout waiting for frame\n");
+        return -1;
+    }
     
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    CLEAR(*buf);
+    buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf->memory = V4L2_MEMORY_MMAP;
     
-    if (xioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
-        if (errno == EAGAIN) {
-            return 0; // 没有可用帧
-        }
+    if (xioctl(fd, VIDIOC_DQBUF, buf) == -1) {
+        if (errno == EAGAIN) return -1; // 没有可用帧
         errno_exit("VIDIOC_DQBUF");
     }
-    
-    *frame_data = (uint8_t*)buffers[buf.index].start;
-    *frame_size = buf.bytesused;
-    
-    if (xioctl(fd, VIDIOC_QBUF, &buf) == -1)
+    return 0;
+}
+
+void requeue_frame(struct v4l2_buffer *buf) {
+    if (xioctl(fd, VIDIOC_QBUF, buf) == -1)
         errno_exit("VIDIOC_QBUF");
-    
-    return buf.index;
 }
 
 void stop_capturing() {
@@ -195,20 +209,6 @@ void close_device() {
     fd = -1;
 }
 
-void save_rgb_frame(const char *filename, const uint8_t *data, int width, int height) {
-    FILE *fp = fopen(filename, "wb");
-    if (!fp) {
-        perror("Cannot open file");
-        return;
-    }
-    
-    // 写入PPM格式 (P6表示二进制RGB)
-    fprintf(fp, "P6\n%d %d\n255\n", width, height);
-    fwrite(data, width * height * 3, 1, fp);
-    fclose(fp);
-    printf("Saved RGB frame to %s (%dx%d)\n", filename, width, height);
-}
-
 void analyze_rgb_data(const uint8_t *data, size_t size) {
     printf("\nRGB Data Analysis:\n");
     printf("  Expected size: %d bytes\n", IMAGE_SIZE);
@@ -218,104 +218,108 @@ void analyze_rgb_data(const uint8_t *data, size_t size) {
         printf("Warning: Frame is incomplete!\n");
     }
     
-    // 分析图像中心区域
-    const int sample_size = 100;
-    const int start_x = WIDTH/2 - sample_size/2;
-    const int start_y = HEIGHT/2 - sample_size/2;
-    
-    int r_sum = 0, g_sum = 0, b_sum = 0;
-    int r_min = 255, g_min = 255, b_min = 255;
-    int r_max = 0, g_max = 0, b_max = 0;
-    
-    for (int y = start_y; y < start_y + sample_size; y++) {
-        for (int x = start_x; x < start_x + sample_size; x++) {
-            int offset = (y * WIDTH + x) * 3;
-            
-            if (offset + 2 >= size) break;
-            
-            uint8_t r = data[offset];
-            uint8_t g = data[offset + 1];
-            uint8_t b = data[offset + 2];
-            
-            r_sum += r; g_sum += g; b_sum += b;
-            
-            if (r < r_min) r_min = r;
-            if (r > r_max) r_max = r;
-            if (g < g_min) g_min = g;
-            if (g > g_max) g_max = g;
-            if (b < b_min) b_min = b;
-            if (b > b_max) b_max = b;
-        }
-    }
-    
-    int total_pixels = sample_size * sample_size;
-    printf("Sample Area (center %dx%d):\n", sample_size, sample_size);
-    printf("  R: avg=%.1f, min=%d, max=%d\n", (float)r_sum/total_pixels, r_min, r_max);
-    printf("  G: avg=%.1f, min=%d, max=%d\n", (float)g_sum/total_pixels, g_min, g_max);
-    printf("  B: avg=%.1f, min=%d, max=%d\n", (float)b_sum/total_pixels, b_min, b_max);
+    // 全帧统计（含直方图）
+    struct frame_stats st;
+    frame_stats_rgb24(data, size, WIDTH, HEIGHT, 1, 1, &st);
+    frame_stats_print(&st, "RGB");
+}
+
+void handle_sigint(int sig) {
+    (void)sig;
+    stop_requested = 1;
 }
 
+// 流式采集：帧拷贝到循环缓冲后立即归还 V4L2 缓冲，由写盘线程在后台编码。
+// num_frames 为 0 时持续采集直到 Ctrl+C，内存占用固定为 POOL_SIZE 帧。
 void capture_frames(int num_frames) {
-    printf("Capturing %d RGB frames at %dx%d resolution...\n", num_frames, WIDTH, HEIGHT);
-    printf("Estimated memory per frame: %.2f MB\n", (float)IMAGE_SIZE/(1024*1024));
+    if (num_frames > 0)
+        printf("Capturing %d RGB frames at %dx%d resolution...\n", num_frames, WIDTH, HEIGHT);
+    else
+        printf("Capturing RGB frames at %dx%d resolution until Ctrl+C...\n", WIDTH, HEIGHT);
+    printf("Frame pool: %d x %.2f MB\n", POOL_SIZE, (float)IMAGE_SIZE/(1024*1024));
+    
+    signal(SIGINT, handle_sigint);
     
     struct timespec start, end;
     clock_gettime(CLOCK_MONOTONIC, &start);
     
     int frames_captured = 0;
-    while (frames_captured < num_frames && frame_count < MAX_FRAMES) {
-        uint8_t *frame_data;
-        size_t frame_size;
+    int dropped_pool = 0;      // 写盘线程跟不上，缓冲池耗尽
+    int dropped_driver = 0;    // 驱动侧丢帧（sequence 不连续）
+    int dropped_short = 0;     // 数据不完整（bytesused 小于一帧）
+    int have_sequence = 0;
+    uint32_t last_sequence = 0;
+    
+    while (!stop_requested && (num_frames == 0 || frames_captured < num_frames)) {
+        struct v4l2_buffer buf;
+        if (dequeue_frame(&buf) < 0)
+            continue;
         
-        if (read_frame(&frame_data, &frame_size)) {
-            // 分配内存存储帧
-            frames[frame_count].data = malloc(frame_size);
-            if (!frames[frame_count].data) {
-                fprintf(stderr, "Memory allocation failed for frame %d\n", frame_count);
-                break;
-            }
-            
-            memcpy(frames[frame_count].data, frame_data, frame_size);
-            frames[frame_count].size = frame_size;
-            clock_gettime(CLOCK_MONOTONIC, &frames[frame_count].timestamp);
-            
-            printf("Frame %d captured: %zu bytes\n", frame_count, frame_size);
-            
-            if (frame_count == 0) {
-                analyze_rgb_data(frames[frame_count].data, frame_size);
-            }
-            
-            frame_count++;
-            frames_captured++;
+        if (have_sequence && buf.sequence > last_sequence + 1)
+            dropped_driver += buf.sequence - last_sequence - 1;
+        last_sequence = buf.sequence;
+        have_sequence = 1;
+        
+        // 不完整的帧不保存：池中缓冲的尾部是旧帧的数据
+        if (buf.bytesused < IMAGE_SIZE) {
+            dropped_short++;
+            requeue_frame(&buf);
+            continue;
+        }
+        
+        struct pool_frame *f = frame_pool_acquire(&frame_pool, 0);
+        if (!f) {
+            dropped_pool++;
+            requeue_frame(&buf);
+            continue;
+        }
+        
+        size_t frame_size = IMAGE_SIZE;
+        memcpy(f->data, buffers[buf.index].start, frame_size);
+        requeue_frame(&buf);
+        
+        f->size = frame_size;
+        f->sequence = frames_captured;
+        clock_gettime(CLOCK_MONOTONIC, &f->timestamp);
+        
+        if (frames_captured == 0) {
+            analyze_rgb_data(f->data, frame_size);
         }
+        
+        // 逐帧降采样统计
+        struct frame_stats st;
+        frame_stats_rgb24(f->data, frame_size, WIDTH, HEIGHT, STATS_STEP, 0, &st);
+        if (frames_captured % REPORT_INTERVAL == 0)
+            printf("Frame %d captured: %zu bytes, G avg=%.1f, clipped=%.2f%%\n", frames_captured, frame_size,
+                   st.ch[1].mean, st.ch[1].count ? 100.0 * st.ch[1].clipped_high / st.ch[1].count : 0.0);
+        
+        // 交给写盘线程，采集继续进行
+        frame_pool_submit(&frame_pool, f);
+        frames_captured++;
     }
     
     clock_gettime(CLOCK_MONOTONIC, &end);
     double elapsed = (end.tv_sec - start.tv_sec) + 
                     (end.tv_nsec - start.tv_nsec) / 1e9;
     
-    printf("\nCapture completed: %d frames in %.2f seconds (%.2f FPS)\n",
+    printf("\nCapture completed: %d frames in %.2f seconds (%.2f FPS sustained)\n",
            frames_captured, elapsed, frames_captured / elapsed);
+    printf("  Dropped: %d (writer too slow), %d (driver), %d (incomplete)\n", dropped_pool, dropped_driver,
+           dropped_short);
 }
 
-void save_all_frames() {
-    for (int i = 0; i < frame_count; i++) {
-        char filename[50];
-        snprintf(filename, sizeof(filename), "frame_%dx%d_%d.ppm", WIDTH, HEIGHT, i);
-        save_rgb_frame(filename, frames[i].data, WIDTH, HEIGHT);
-    }
-}
-
-void free_frames() {
-    for (int i = 0; i < frame_count; i++) {
-        free(frames[i].data);
-        frames[i].data = NULL;
-        frames[i].size = 0;
-    }
-    frame_count = 0;
-}
-
+// 用法: rgb [帧数] [格式]，帧数为 0 时持续到 Ctrl+C，格式为 qoi（默认）/ png / ppm
 int main(int argc, char *argv[]) {
+    enum image_format fmt = IMG_QOI;
+    if (argc > 2) {
+        int parsed = image_format_parse(argv[2]);
+        if (parsed < 0) {
+            fprintf(stderr, "Unknown output format: %s (use qoi, png or ppm)\n", argv[2]);
+            exit(EXIT_FAILURE);
+        }
+        fmt = parsed;
+    }
+    
     // 打开设备
     fd = open(DEVICE_NAME, O_RDWR | O_NONBLOCK, 0);
     if (fd == -1) {
@@ -342,18 +346,34 @@ int main(int argc, char *argv[]) {
     // 捕获帧
     int num_frames = 3;
     if (argc > 1) num_frames = atoi(argv[1]);
-    if (num_frames <= 0 || num_frames > MAX_FRAMES) num_frames = 3;
+    if (num_frames < 0) num_frames = 3;
     
-    capture_frames(num_frames);
+    // 启动后台写盘线程，边采集边编码
+    if (frame_pool_init(&frame_pool, POOL_SIZE, IMAGE_SIZE) != 0) {
+        fprintf(stderr, "Memory allocation failed for frame pool\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "frame_%dx%d", WIDTH, HEIGHT);
+    struct image_writer writer;
+    if (image_writer_start(&writer, &frame_pool, fmt, WIDTH, HEIGHT, prefix, WRITER_THREADS) != 0) {
+        fprintf(stderr, "Cannot create writer threads\n");
+        exit(EXIT_FAILURE);
+    }
     
-    // 保存帧
-    save_all_frames();
+    capture_frames(num_frames);
     
     // 清理
     stop_capturing();
     uninit_device();
     close_device();
-    free_frames();
+    
+    // 等待剩余帧写完
+    frame_pool_close(&frame_pool);
+    image_writer_join(&writer);
+    image_writer_print_summary(&writer);
+    frame_pool_destroy(&frame_pool);
     
     return 0;
 }
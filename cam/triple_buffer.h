@@ -0,0 +1,68 @@
+#pragma once
+
+// 无锁三缓冲：单生产者/单消费者之间传递“最新一帧”。
+// 三个槽分别归生产者（back）、消费者（front）和中间交换位（middle）所有，
+// 交接时只原子交换槽下标，不拷贝数据、不加锁，双方互不阻塞。
+// 生产者来不及被消费的旧帧直接被覆盖，消费者每次拿到的总是最近一次完整发布的帧。
+// 消费者可以用 wait_update() 睡眠等待新帧（futex），生产者只在有人等待时才多一次唤醒系统调用。
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+template <typename T>
+class TripleBuffer {
+public:
+    // 生产者：在 back() 中准备好一帧后调用 publish()，换到一个空闲槽继续写
+    T& back() { return slots[back_index]; }
+
+    void publish() {
+        // 与 wait_update() 中 waiting/middle 的读写配对，使用顺序一致的内存序，保证不丢唤醒
+        uint8_t prev = middle.exchange(uint8_t(back_index | FRESH));
+        back_index = prev & INDEX_MASK;
+        epoch.fetch_add(1);
+        if (waiting.load())
+            syscall(SYS_futex, futex_word(), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    // 消费者：有新发布的帧时换到 front() 并返回 true；否则 front() 保持上一帧
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        uint8_t prev = middle.exchange(front_index, std::memory_order_acq_rel);
+        front_index = prev & INDEX_MASK;
+        return true;
+    }
+
+    // 消费者：最多等待 timeout_ms 毫秒直到有新帧，返回值同 update()
+    bool wait_update(int timeout_ms) {
+        if (update()) return true;
+        uint32_t seen = epoch.load();
+        waiting.store(true);
+        if (!(middle.load() & FRESH)) {
+            timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+            syscall(SYS_futex, futex_word(), FUTEX_WAIT_PRIVATE, seen, &timeout, nullptr, 0);
+        }
+        waiting.store(false, std::memory_order_relaxed);
+        return update();
+    }
+
+    // front() 只归消费者，可以直接在上面叠加文字等
+    T& front() { return slots[front_index]; }
+
+    uint32_t publish_count() const { return epoch.load(std::memory_order_relaxed); }
+
+private:
+    enum : uint8_t { INDEX_MASK = 3, FRESH = 4 };
+
+    uint32_t* futex_word() { return reinterpret_cast<uint32_t*>(&epoch); }
+
+    T slots[3];
+    uint8_t back_index = 0;                        // 只由生产者访问
+    alignas(64) uint8_t front_index = 1;           // 只由消费者访问
+    alignas(64) std::atomic<uint8_t> middle{2};
+    std::atomic<uint32_t> epoch{0};                // 每次发布加一，也是 futex 等待的地址
+    std::atomic<bool> waiting{false};
+};
@@ -0,0 +1,359 @@
+#pragma once
+
+// 长时间录制的压缩视频模式：逐帧 JPEG 在 3264x2448 下每分钟数 GB，7x24 监控用帧间压缩。
+// 保存线程把 JPEG 拷入小的待编码队列后立即返回；编码线程（可绑定到专用核心）以 1/2、1/4、1/8
+// 分辨率解码（libjpeg 在 DCT 阶段缩小），通过管道交给 ffmpeg 子进程编码 H.264（libx264，
+// 子进程继承编码线程的 CPU 绑定；写入和退出码都检查，编码或写盘失败能被发现），按时长切分为独立文件。
+// H.264 不可用时改写 MJPEG-AVI；全分辨率 MJPEG 直接写入摄像头输出的 JPEG，不解码。
+// 编码跟不上（待编码队列满而丢帧）时逐级降低分辨率，到 1/8 后再隔帧取样（全分辨率 MJPEG 直写
+// 不解码，降分辨率反而更慢，直接隔帧取样）；
+// 负载长期足够低时逐级恢复，但不超过初始设置。每次调整都另起一个分段。
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+#include "avi_writer.h"
+#include "ffmpeg_pipe.h"
+
+#define VIDEO_QUEUE_FRAMES    4     // 待编码队列长度，满了就丢帧并计入降级判断
+#define VIDEO_WINDOW_SEC      10    // 统计窗口（按采集时间戳）
+#define VIDEO_DROP_TOLERANCE  0.02  // 窗口内丢帧超过该比例即降级
+#define VIDEO_RECOVER_WINDOWS 6     // 连续多少个空闲窗口后恢复一级
+#define VIDEO_MAX_STRIDE      8
+
+enum class VideoCodec { H264, Mjpeg };
+
+struct SegmenterConfig {
+    VideoCodec codec = VideoCodec::H264;
+    std::string prefix = "video";   // 分段文件名：<prefix>_<日期>_<时间>_<序号>.mp4/.avi
+    double segment_sec = 600;
+    int reduce = 2;                 // 初始解码缩小倍数 1/2/4/8，也是恢复的上限
+    int jpeg_quality = 80;          // 缩小后重新编码 MJPEG 的质量
+    std::vector<int> cpus;          // 编码线程绑定的核心，空表示不绑定
+};
+
+class VideoSegmenter {
+public:
+    ~VideoSegmenter() { stop(); }
+
+    // width/height 为摄像头输出分辨率，nominal_fps 为驱动报告的帧率（未知时传 0）
+    bool start(const SegmenterConfig& c, int width, int height, double nominal_fps) {
+        cfg = c;
+        codec = cfg.codec;
+        src_width = width;
+        src_height = height;
+        fps_hint = nominal_fps > 0 ? nominal_fps : 30.0;
+        reduce = cfg.reduce;
+        stride = 1;
+        for (auto& p : pending) p.jpeg.reserve(size_t(width) * height / 4);
+        worker = std::thread(&VideoSegmenter::encode_loop, this);
+        return true;
+    }
+
+    // 保存线程调用：拷贝一帧到待编码队列；被隔帧取样跳过或队列已满时返回 false
+    bool offer(const uint8_t* jpeg, size_t size, uint64_t timestamp_ns) {
+        if (offered++ % stride.load() != 0) return false;
+        std::unique_lock<std::mutex> lock(m);
+        if (count == VIDEO_QUEUE_FRAMES) {
+            dropped++;
+            return false;
+        }
+        Pending& p = pending[(head + count) % VIDEO_QUEUE_FRAMES];
+        p.jpeg.assign(jpeg, jpeg + size);
+        p.timestamp_ns = timestamp_ns;
+        count++;
+        lock.unlock();
+        ready.notify_one();
+        return true;
+    }
+
+    // 编码完队列中剩余的帧，关闭当前分段
+    void stop() {
+        if (!worker.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            quit = true;
+        }
+        ready.notify_all();
+        worker.join();
+    }
+
+    uint64_t encoded_frames() const { return encoded; }
+
+    void print_summary() const {
+        printf("压缩录制（%s）: %d 个分段（%d 个关闭时出错），编码 %llu 帧，待编码队列满丢弃 %llu 帧，"
+               "解码失败 %d，写入失败 %d\n",
+               codec == VideoCodec::H264 ? "H.264" : "MJPEG-AVI", segments, segment_failures,
+               (unsigned long long)encoded, (unsigned long long)dropped.load(), decode_failures, write_failures);
+        printf("  编码能力 %.1f 帧/秒，编码线程忙 %.1f 秒；降级 %d 次，恢复 %d 次，"
+               "最终 1/%d 分辨率、每 %d 帧取 1 帧\n",
+               busy_sec > 0 ? encoded / busy_sec : 0.0, busy_sec, degrades, recoveries,
+               reduce, stride.load());
+    }
+
+private:
+    struct Pending {
+        std::vector<uint8_t> jpeg;
+        uint64_t timestamp_ns = 0;
+    };
+
+    void encode_loop() {
+        if (!cfg.cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int c : cfg.cpus) CPU_SET(c, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+                fprintf(stderr, "编码线程绑定核心失败\n");
+        }
+        for (;;) {
+            std::unique_lock<std::mutex> lock(m);
+            ready.wait(lock, [this] { return count > 0 || quit; });
+            if (count == 0) break;
+            // 处理期间该帧仍占着队列位置，offer() 只会写入其后的空位
+            Pending& p = pending[head];
+            lock.unlock();
+
+            encode_frame(p);
+
+            lock.lock();
+            head = (head + 1) % VIDEO_QUEUE_FRAMES;
+            count--;
+        }
+        close_segment();
+    }
+
+    void encode_frame(const Pending& p) {
+        auto t0 = std::chrono::steady_clock::now();
+        bool ok;
+        if (codec == VideoCodec::Mjpeg && reduce == 1) {
+            ok = ensure_segment(src_width, src_height, p.timestamp_ns) &&
+                 avi.add_frame(p.jpeg.data(), p.jpeg.size());
+        } else {
+            cv::Mat encoded_jpeg(1, int(p.jpeg.size()), CV_8UC1, const_cast<uint8_t*>(p.jpeg.data()));
+            cv::imdecode(encoded_jpeg, decode_flags(reduce), &image);
+            if (image.empty()) {
+                // 解码失败的耗时同样计入负载，窗口照常推进
+                decode_failures++;
+                account(t0);
+                update_window(p.timestamp_ns);
+                return;
+            }
+            ok = ensure_segment(image.cols, image.rows, p.timestamp_ns);
+            if (ok && codec == VideoCodec::H264) {
+                ok = image.isContinuous() && image.cols == segment_width && image.rows == segment_height &&
+                     h264.write(image.data);
+            } else if (ok) {
+                ok = cv::imencode(".jpg", image, reencoded, {cv::IMWRITE_JPEG_QUALITY, cfg.jpeg_quality}) &&
+                     avi.add_frame(reencoded.data(), reencoded.size());
+            }
+        }
+        account(t0);
+        if (ok) {
+            encoded++;
+            segment_frames++;
+            segment_last_ns = p.timestamp_ns;
+        } else if (segment_open) {
+            // 分段已打开但写入失败：结束当前分段，下一帧重新打开一个
+            write_failures++;
+            close_segment();
+        }
+        update_window(p.timestamp_ns);
+    }
+
+    void account(std::chrono::steady_clock::time_point t0) {
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        busy_sec += sec;
+        window_busy_sec += sec;
+        segment_busy_sec += sec;
+    }
+
+    // 全分辨率 MJPEG 直写 JPEG，不经过解码和编码
+    bool passthrough() const { return codec == VideoCodec::Mjpeg && cfg.reduce == 1; }
+
+    static int decode_flags(int r) {
+        switch (r) {
+        case 2: return cv::IMREAD_REDUCED_COLOR_2;
+        case 4: return cv::IMREAD_REDUCED_COLOR_4;
+        case 8: return cv::IMREAD_REDUCED_COLOR_8;
+        default: return cv::IMREAD_COLOR;
+        }
+    }
+
+    // 分段到时长或 AVI 写满时换下一个文件
+    bool ensure_segment(int w, int h, uint64_t timestamp_ns) {
+        if (segment_open && (timestamp_ns - segment_start_ns >= uint64_t(cfg.segment_sec * 1e9) ||
+                             (codec == VideoCodec::Mjpeg && avi.full())))
+            close_segment();
+        if (!segment_open) open_segment(w, h, timestamp_ns);
+        return segment_open;
+    }
+
+    void open_segment(int w, int h, uint64_t timestamp_ns) {
+        double fps = (capture_fps > 0 ? capture_fps : fps_hint) / stride;
+        if (codec == VideoCodec::H264) {
+            segment_name = make_name(".mp4");
+            if (!h264.open(segment_name, w, h, fps)) {
+                fprintf(stderr, "H.264 编码器不可用（找不到 ffmpeg），改为 MJPEG-AVI\n");
+                codec = VideoCodec::Mjpeg;
+            }
+        }
+        if (codec == VideoCodec::Mjpeg) {
+            segment_name = make_name(".avi");
+            if (!avi.open(segment_name.c_str(), w, h, fps)) return;
+        }
+        segment_open = true;
+        segment_width = w;
+        segment_height = h;
+        segment_start_ns = timestamp_ns;
+        segment_last_ns = timestamp_ns;
+        segment_frames = 0;
+        segment_busy_sec = 0;
+        segments++;
+        printf("开始分段 %s（%dx%d，%.2f FPS）\n", segment_name.c_str(), w, h, fps);
+    }
+
+    void close_segment() {
+        if (!segment_open) return;
+        bool closed;
+        if (codec == VideoCodec::H264) {
+            closed = h264.close();
+        } else {
+            closed = avi.close();
+            if (!closed) perror("关闭AVI分段失败");
+        }
+        segment_open = false;
+        if (!closed) segment_failures++;
+        // 一帧都没编码成功就失败（ffmpeg 不带 libx264 等），后面的分段也不会成功
+        if (!closed && codec == VideoCodec::H264 && segment_frames == 0) {
+            fprintf(stderr, "H.264 编码失败，改为 MJPEG-AVI\n");
+            codec = VideoCodec::Mjpeg;
+        }
+        double sec = (segment_last_ns - segment_start_ns) / 1e9;
+        printf("分段 %s 结束: %llu 帧，%.1f 秒，编码能力 %.1f 帧/秒（采集 %.1f 帧/秒）\n",
+               segment_name.c_str(), (unsigned long long)segment_frames, sec,
+               segment_busy_sec > 0 ? segment_frames / segment_busy_sec : 0.0, capture_fps);
+    }
+
+    std::string make_name(const char* ext) {
+        char stamp[32];
+        time_t now = time(nullptr);
+        strftime(stamp, sizeof(stamp), "_%Y%m%d_%H%M%S", localtime(&now));
+        char index[16];
+        snprintf(index, sizeof(index), "_%03d", segments);
+        return cfg.prefix + stamp + index + ext;
+    }
+
+    // 每个统计窗口比较编码能力和采集帧率，决定降级或恢复
+    void update_window(uint64_t timestamp_ns) {
+        if (window_start_ns == 0) {
+            start_window(timestamp_ns);
+            return;
+        }
+        double sec = (timestamp_ns - window_start_ns) / 1e9;
+        if (sec < VIDEO_WINDOW_SEC) return;
+
+        uint64_t offered_n = offered - window_offered;
+        uint64_t dropped_n = dropped - window_dropped;
+        uint64_t kept_n = (offered_n + stride - 1) / stride;
+        capture_fps = offered_n / sec;
+        double load = window_busy_sec / sec;
+
+        if (dropped_n > kept_n * VIDEO_DROP_TOLERANCE) {
+            calm_windows = 0;
+            if (reduce < 8 && !passthrough()) reduce *= 2;
+            else if (stride < VIDEO_MAX_STRIDE) stride = stride * 2;
+            else {
+                start_window(timestamp_ns);
+                return;
+            }
+            degrades++;
+            printf("编码跟不上（%.0f 秒内丢弃 %llu/%llu 帧，采集 %.1f 帧/秒）：降为 1/%d 分辨率，每 %d 帧取 1 帧\n",
+                   sec, (unsigned long long)dropped_n, (unsigned long long)kept_n, capture_fps,
+                   reduce, stride.load());
+            close_segment();
+        } else if (dropped_n == 0 && load * recover_cost() < 0.8 && can_recover()) {
+            // 恢复一级后的负载按像素数或帧数的倍数估计，留出余量避免来回切换
+            if (++calm_windows >= VIDEO_RECOVER_WINDOWS) {
+                calm_windows = 0;
+                if (stride > 1) stride = stride / 2;
+                else reduce /= 2;
+                recoveries++;
+                printf("编码负载 %.0f%%：恢复为 1/%d 分辨率，每 %d 帧取 1 帧\n", load * 100, reduce, stride.load());
+                close_segment();
+            }
+        } else {
+            calm_windows = 0;
+        }
+        start_window(timestamp_ns);
+    }
+
+    void start_window(uint64_t timestamp_ns) {
+        window_start_ns = timestamp_ns;
+        window_offered = offered;
+        window_dropped = dropped;
+        window_busy_sec = 0;
+    }
+
+    bool can_recover() const { return stride > 1 || reduce > cfg.reduce; }
+    double recover_cost() const { return stride > 1 ? 2.0 : 4.0; }
+
+    SegmenterConfig cfg;
+    VideoCodec codec = VideoCodec::H264;
+    int src_width = 0;
+    int src_height = 0;
+    double fps_hint = 30.0;
+
+    // 待编码队列：offer() 写入 head+count，编码线程处理完 head 后才释放
+    Pending pending[VIDEO_QUEUE_FRAMES];
+    size_t head = 0;
+    size_t count = 0;
+    bool quit = false;
+    std::mutex m;
+    std::condition_variable ready;
+    std::thread worker;
+
+    // 以下只在编码线程中使用（stride 由 offer() 读取）
+    cv::Mat image;
+    std::vector<uint8_t> reencoded;
+    FfmpegPipe h264;
+    AviWriter avi;
+    bool segment_open = false;
+    int segment_width = 0;
+    int segment_height = 0;
+    std::string segment_name;
+    uint64_t segment_start_ns = 0;
+    uint64_t segment_frames = 0;
+    double segment_busy_sec = 0;
+    uint64_t segment_last_ns = 0;
+    int segments = 0;
+
+    int reduce = 2;
+    std::atomic<int> stride{1};
+    double capture_fps = 0;
+    uint64_t window_start_ns = 0;
+    uint64_t window_offered = 0;
+    uint64_t window_dropped = 0;
+    double window_busy_sec = 0;
+    int calm_windows = 0;
+    int degrades = 0;
+    int recoveries = 0;
+
+    std::atomic<uint64_t> offered{0};
+    std::atomic<uint64_t> dropped{0};
+    uint64_t encoded = 0;
+    double busy_sec = 0;
+    int decode_failures = 0;
+    int write_failures = 0;
+    int segment_failures = 0;
+};
@@ -10,6 +10,13 @@
 #include <errno.h>
 #include <time.h>
 #include <math.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/select.h>
+
+#include "frame_pool.h"
+#include "frame_stats.h"
+#include "rawrec.h"
 
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
 #define DEVICE_NAME "/dev/video0"
@@ -18,6 +25,10 @@
 #define PIXEL_FORMAT V4L2_PIX_FMT_YUYV  // YUV422 格式
 #define BUFFER_COUNT 4
 #define MAX_FRAMES 5  // 最大保存帧数（防止内存不足）
+#define STATS_STEP 2  // 逐帧统计的采样网格间隔
+#define RAWREC_THREADS 4  // LZ4 并行压缩线程数
+#define POOL_SIZE 4       // 流式模式循环使用的帧缓冲数量，决定内存上限
+#define REPORT_INTERVAL 30  // 流式模式每隔多少帧打印一次统计
 
 // 计算 YUV422 图像大小
 #define IMAGE_SIZE (WIDTH * HEIGHT * 2)
@@ -231,47 +242,10 @@ void analyze_yuv_data(const unsigned char *data, size_t size) {
         printf("Warning: Frame is incomplete!\n");
     }
     
-    // 计算统计信息
-    int y_sum = 0, u_sum = 0, v_sum = 0;
-    int y_min = 255, u_min = 255, v_min = 255;
-    int y_max = 0, u_max = 0, v_max = 0;
-    
-    // 只分析图像中心 100x100 区域（避免全图分析耗时）
-    const int sample_size = 100;
-    const int start_x = WIDTH/2 - sample_size/2;
-    const int start_y = HEIGHT/2 - sample_size/2;
-    
-    for (int y = start_y; y < start_y + sample_size; y++) {
-        for (int x = start_x; x < start_x + sample_size; x++) {
-            int offset = y * WIDTH * 2 + x * 2;
-            
-            // YUYV 布局: [Y0, U, Y1, V] 每4字节对应2像素
-            if (offset + 3 >= size) break;
-            
-            uint8_t y0 = data[offset];
-            uint8_t u = data[offset + 1];
-            uint8_t y1 = data[offset + 2];
-            uint8_t v = data[offset + 3];
-            
-            // 更新统计
-            y_sum += y0 + y1;
-            u_sum += u;
-            v_sum += v;
-            
-            if (y0 < y_min) y_min = y0;
-            if (y0 > y_max) y_max = y0;
-            if (u < u_min) u_min = u;
-            if (u > u_max) u_max = u;
-            if (v < v_min) v_min = v;
-            if (v > v_max) v_max = v;
-        }
-    }
-    
-    int total_pixels = 2 * sample_size * sample_size;
-    printf("Sample Area (center %dx%d):\n", sample_size, sample_size);
-    printf("  Y: avg=%.1f, min=%d, max=%d\n", (float)y_sum/total_pixels, y_min, y_max);
-    printf("  U: avg=%.1f, min=%d, max=%d\n", (float)u_sum/(sample_size*sample_size), u_min, u_max);
-    printf("  V: avg=%.1f, min=%d, max=%d\n", (float)v_sum/(sample_size*sample_size), v_min, v_max);
+    // 全帧统计（含直方图）
+    struct frame_stats st;
+    frame_stats_yuyv(data, size, WIDTH, HEIGHT, 1, 1, &st);
+    frame_stats_print(&st, "YUV");
 }
 
 // 捕获并存储帧
@@ -301,7 +275,11 @@ void capture_and_store(int num_frames) {
             frames[frame_count].size = frame_size;
             clock_gettime(CLOCK_MONOTONIC, &frames[frame_count].timestamp);
             
-            printf("Frame %d captured: %zu bytes\n", frame_count, frame_size);
+            // 逐帧降采样统计，供曝光/质量判断使用
+            struct frame_stats st;
+            frame_stats_yuyv(frames[frame_count].data, frame_size, WIDTH, HEIGHT, STATS_STEP, 0, &st);
+            printf("Frame %d captured: %zu bytes, Y avg=%.1f, clipped=%.2f%%\n", frame_count, frame_size,
+                   st.ch[0].mean, st.ch[0].count ? 100.0 * st.ch[0].clipped_high / st.ch[0].count : 0.0);
             
             // 分析第一帧
             if (frame_count == 0) {
@@ -340,6 +318,220 @@ void save_all_frames() {
     }
 }
 
+// ========================= LZ4 录制模式 =========================
+// 每帧直接从出队的 V4L2 缓冲分块并行压缩，追加到单个带索引的 .yl4 文件，
+// 不再受 MAX_FRAMES 限制；用 rawplay 按帧号解压回放。
+static volatile sig_atomic_t stop_requested = 0;
+
+void handle_sigint(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// 等待并出队一帧，处理完后需调用 requeue_frame 归还给驱动
+int dequeue_frame(struct v4l2_buffer *buf) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    struct timeval tv = { .tv_sec = 2, .tv_usec = 0 };
+
+    int r = select(fd + 1, &fds, NULL, NULL, &tv);
+    if (r == -1) {
+        if (errno == EINTR) return -1;
+        errno_exit("select");
+    }
+    if (r == 0) {
+        fprintf(stderr, "Timeout waiting for frame\n");
+        return -1;
+    }
+
+    CLEAR(*buf);
+    buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf->memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(fd, VIDIOC_DQBUF, buf) == -1) {
+        if (errno == EAGAIN) return -1;
+        errno_exit("VIDIOC_DQBUF");
+    }
+    return 0;
+}
+
+void requeue_frame(struct v4l2_buffer *buf) {
+    if (xioctl(fd, VIDIOC_QBUF, buf) == -1)
+        errno_exit("VIDIOC_QBUF");
+}
+
+// num_frames 为 0 时持续录制直到 Ctrl+C
+void record_lz4(const char *path, int num_frames) {
+    struct rawrec_writer rec;
+    if (rawrec_open(&rec, path, WIDTH, HEIGHT, PIXEL_FORMAT, IMAGE_SIZE, RAWREC_THREADS) != 0)
+        exit(EXIT_FAILURE);
+
+    if (num_frames > 0)
+        printf("Recording %d frames to %s...\n", num_frames, path);
+    else
+        printf("Recording to %s until Ctrl+C...\n", path);
+    signal(SIGINT, handle_sigint);
+
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    int frames_recorded = 0;
+    while (!stop_requested && (num_frames == 0 || frames_recorded < num_frames)) {
+        struct v4l2_buffer buf;
+        if (dequeue_frame(&buf) < 0)
+            continue;
+
+        uint64_t ts = (uint64_t)buf.timestamp.tv_sec * 1000000000ull + buf.timestamp.tv_usec * 1000ull;
+        int ret = rawrec_write_frame(&rec, buffers[buf.index].start, buf.bytesused, buf.sequence, ts);
+        requeue_frame(&buf);
+        if (ret < 0)
+            break;
+
+        frames_recorded++;
+        if (frames_recorded % 30 == 0)
+            printf("  %d frames, %.1f MB on disk\n", frames_recorded, rawrec_stored_bytes(&rec) / (1024.0 * 1024.0));
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    double total_time = (end_time.tv_sec - start_time.tv_sec) +
+                       (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    printf("\nRecording completed: %d frames in %.2f seconds (%.2f FPS)\n",
+           frames_recorded, total_time, frames_recorded / total_time);
+
+    if (rawrec_close(&rec) != 0)
+        fprintf(stderr, "Warning: recording index not written, rawplay will rebuild it\n");
+    rawrec_print_summary(&rec);
+}
+
+// ========================= 流式模式 =========================
+// 帧拷贝到循环缓冲后立即归还 V4L2 缓冲，后台线程写盘；内存占用固定为 POOL_SIZE 帧。
+static struct frame_pool frame_pool;
+
+struct writer_stats {
+    int frames_written;
+    uint64_t bytes_written;
+    double busy_time;
+};
+
+void *raw_writer_thread(void *arg) {
+    struct writer_stats *ws = arg;
+    struct pool_frame *f;
+    
+    while ((f = frame_pool_next(&frame_pool)) != NULL) {
+        char filename[64];
+        snprintf(filename, sizeof(filename), "frame_%dx%d_%06u.yuv", WIDTH, HEIGHT, f->sequence);
+        
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        FILE *fp = fopen(filename, "wb");
+        if (fp) {
+            if (fwrite(f->data, f->size, 1, fp) == 1) {
+                ws->frames_written++;
+                ws->bytes_written += f->size;
+            }
+            fclose(fp);
+        } else {
+            perror("Cannot open file");
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ws->busy_time += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        
+        frame_pool_release(&frame_pool, f);
+    }
+    return NULL;
+}
+
+// num_frames 为 0 时持续采集直到 Ctrl+C
+void capture_streaming(int num_frames) {
+    if (num_frames > 0)
+        printf("Streaming %d frames at %dx%d resolution...\n", num_frames, WIDTH, HEIGHT);
+    else
+        printf("Streaming at %dx%d resolution until Ctrl+C...\n", WIDTH, HEIGHT);
+    printf("Frame pool: %d x %.2f MB\n", POOL_SIZE, (float)IMAGE_SIZE/(1024*1024));
+    
+    if (frame_pool_init(&frame_pool, POOL_SIZE, IMAGE_SIZE) != 0) {
+        fprintf(stderr, "Memory allocation failed for frame pool\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    struct writer_stats ws = {0};
+    pthread_t writer;
+    if (pthread_create(&writer, NULL, raw_writer_thread, &ws) != 0) {
+        fprintf(stderr, "Cannot create writer thread\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    signal(SIGINT, handle_sigint);
+    
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    
+    int frames_captured = 0;
+    int dropped_pool = 0;      // 写盘线程跟不上，缓冲池耗尽
+    int dropped_driver = 0;    // 驱动侧丢帧（sequence 不连续）
+    int have_sequence = 0;
+    uint32_t last_sequence = 0;
+    
+    while (!stop_requested && (num_frames == 0 || frames_captured < num_frames)) {
+        struct v4l2_buffer buf;
+        if (dequeue_frame(&buf) < 0)
+            continue;
+        
+        if (have_sequence && buf.sequence > last_sequence + 1)
+            dropped_driver += buf.sequence - last_sequence - 1;
+        last_sequence = buf.sequence;
+        have_sequence = 1;
+        
+        struct pool_frame *f = frame_pool_acquire(&frame_pool, 0);
+        if (!f) {
+            dropped_pool++;
+            requeue_frame(&buf);
+            continue;
+        }
+        
+        size_t frame_size = buf.bytesused;
+        if (frame_size > IMAGE_SIZE) frame_size = IMAGE_SIZE;
+        memcpy(f->data, buffers[buf.index].start, frame_size);
+        requeue_frame(&buf);
+        
+        f->size = frame_size;
+        f->sequence = frames_captured;
+        clock_gettime(CLOCK_MONOTONIC, &f->timestamp);
+        
+        if (frames_captured == 0)
+            analyze_yuv_data(f->data, frame_size);
+        
+        if (frames_captured % REPORT_INTERVAL == 0) {
+            struct frame_stats st;
+            frame_stats_yuyv(f->data, frame_size, WIDTH, HEIGHT, STATS_STEP, 0, &st);
+            printf("Frame %d captured: %zu bytes, Y avg=%.1f, clipped=%.2f%%\n", frames_captured, frame_size,
+                   st.ch[0].mean, st.ch[0].count ? 100.0 * st.ch[0].clipped_high / st.ch[0].count : 0.0);
+        }
+        
+        frame_pool_submit(&frame_pool, f);
+        frames_captured++;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    frame_pool_close(&frame_pool);
+    pthread_join(writer, NULL);
+    frame_pool_destroy(&frame_pool);
+    
+    double total_time = (end_time.tv_sec - start_time.tv_sec) +
+                       (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    printf("\nStreaming completed: %d frames in %.2f seconds (%.2f FPS sustained)\n",
+           frames_captured, total_time, frames_captured / total_time);
+    printf("  Dropped: %d (writer too slow), %d (driver)\n", dropped_pool, dropped_driver);
+    printf("  Written: %d frames, %.1f MB", ws.frames_written, ws.bytes_written / (1024.0 * 1024.0));
+    if (ws.busy_time > 0)
+        printf(" (%.1f MB/s while writing)", ws.bytes_written / (1024.0 * 1024.0) / ws.busy_time);
+    printf("\n");
+}
+
+// 用法: yuv [帧数]                  采集后保存为 .yuv（最多 MAX_FRAMES 帧）
+//       yuv -s [帧数]               流式采集保存 .yuv，帧数为 0 或省略时持续到 Ctrl+C
+//       yuv -r <文件.yl4> [帧数]    LZ4 压缩录制，帧数为 0 或省略时持续到 Ctrl+C
 int main(int argc, char *argv[]) {
     // 打开设备
     fd = open(DEVICE_NAME, O_RDWR | O_NONBLOCK, 0);
@@ -364,6 +556,28 @@ int main(int argc, char *argv[]) {
     // 开始捕获
     start_capturing();
     
+    if (argc > 1 && strcmp(argv[1], "-s") == 0) {
+        int num_frames = argc > 2 ? atoi(argv[2]) : 0;
+        if (num_frames < 0) num_frames = 0;
+        
+        capture_streaming(num_frames);
+        stop_capturing();
+        uninit_device();
+        close_device();
+        return 0;
+    }
+    
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        int num_frames = argc > 3 ? atoi(argv[3]) : 0;
+        if (num_frames < 0) num_frames = 0;
+        
+        record_lz4(argv[2], num_frames);
+        stop_capturing();
+        uninit_device();
+        close_device();
+        return 0;
+    }
+    
     // 捕获并存储帧
     int num_frames = 3; // 默认捕获3帧
     if (argc > 1) num_frames = atoi(argv[1]);
@@ -11,6 +11,13 @@
 #include <math.h>
 #include <stdint.h>
 #include <sys/sysmacros.h>
+#include <sys/select.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include "frame_pool.h"
+#include "frame_stats.h"
+#include "frame_writer.h"
 
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
 #define DEVICE_NAME "/dev/video0"
@@ -19,7 +26,11 @@
 #define PIXEL_FORMAT V4L2_PIX_FMT_YUYV
 #define BUFFER_COUNT 4
 #define MAX_FRAMES 5
+#define STATS_STEP 2  // 逐帧统计的采样网格间隔
 #define IMAGE_SIZE (WIDTH * HEIGHT * 2)
+#define RGB_SIZE (WIDTH * HEIGHT * 3)
+#define WRITER_THREADS 3  // 后台编码写盘线程数
+#define RGB_POOL_SIZE (WRITER_THREADS + 1)  // 循环使用的RGB缓冲数量
 
 struct FrameData {
     unsigned char *data;
@@ -202,43 +213,9 @@ void analyze_yuv_data(const unsigned char *data, size_t size) {
         printf("Warning: Frame is incomplete!\n");
     }
     
-    int y_sum = 0, u_sum = 0, v_sum = 0;
-    int y_min = 255, u_min = 255, v_min = 255;
-    int y_max = 0, u_max = 0, v_max = 0;
-    
-    const int sample_size = 100;
-    const int start_x = WIDTH/2 - sample_size/2;
-    const int start_y = HEIGHT/2 - sample_size/2;
-    
-    for (int y = start_y; y < start_y + sample_size; y++) {
-        for (int x = start_x; x < start_x + sample_size; x++) {
-            int offset = y * WIDTH * 2 + x * 2;
-            
-            if (offset + 3 >= size) break;
-            
-            uint8_t y0 = data[offset];
-            uint8_t u = data[offset + 1];
-            uint8_t y1 = data[offset + 2];
-            uint8_t v = data[offset + 3];
-            
-            y_sum += (int)y0 + (int)y1;
-            u_sum += (int)u;
-            v_sum += (int)v;
-            
-            if (y0 < y_min) y_min = y0;
-            if (y0 > y_max) y_max = y0;
-            if (u < u_min) u_min = u;
-            if (u > u_max) u_max = u;
-            if (v < v_min) v_min = v;
-            if (v > v_max) v_max = v;
-        }
-    }
-    
-    int total_pixels = 2 * sample_size * sample_size;
-    printf("Sample Area (center %dx%d):\n", sample_size, sample_size);
-    printf("  Y: avg=%.1f, min=%d, max=%d\n", (float)y_sum/total_pixels, y_min, y_max);
-    printf("  U: avg=%.1f, min=%d, max=%d\n", (float)u_sum/(sample_size*sample_size), u_min, u_max);
-    printf("  V: avg=%.1f, min=%d, max=%d\n", (float)v_sum/(sample_size*sample_size), v_min, v_max);
+    struct frame_stats st;
+    frame_stats_yuyv(data, size, WIDTH, HEIGHT, 1, 1, &st);
+    frame_stats_print(&st, "YUV");
 }
 
 void capture_and_store(int num_frames) {
@@ -265,7 +242,10 @@ void capture_and_store(int num_frames) {
             frames[frame_count].size = frame_size;
             clock_gettime(CLOCK_MONOTONIC, &frames[frame_count].timestamp);
             
-            printf("Frame %d captured: %zu bytes\n", frame_count, frame_size);
+            struct frame_stats st;
+            frame_stats_yuyv(frames[frame_count].data, frame_size, WIDTH, HEIGHT, STATS_STEP, 0, &st);
+            printf("Frame %d captured: %zu bytes, Y avg=%.1f, clipped=%.2f%%\n", frame_count, frame_size,
+                   st.ch[0].mean, st.ch[0].count ? 100.0 * st.ch[0].clipped_high / st.ch[0].count : 0.0);
             
             if (frame_count == 0) {
                 analyze_yuv_data(frames[frame_count].data, frame_size);
@@ -335,29 +315,174 @@ void yuyv_to_rgb24(const unsigned char *yuyv, unsigned char *rgb, int width, int
     }
 }
 
-// ========================= 保存RGB为PPM文件 =========================
-void save_rgb_to_ppm(const char *filename, const unsigned char *rgb, int width, int height) {
-    FILE *fp = fopen(filename, "wb");
-    if (!fp) {
-        perror("Cannot open PPM file");
+// ========================= 流式模式 =========================
+// 直接从出队的 V4L2 缓冲转换到循环使用的 RGB 缓冲，转换完立即把 V4L2 缓冲
+// 重新入队，RGB 帧交给后台写盘线程编码；内存占用固定为 RGB_POOL_SIZE 个 RGB 缓冲。
+static volatile sig_atomic_t stop_requested = 0;
+static struct frame_pool rgb_pool;
+
+void handle_sigint(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// 等待并出队一帧，处理完后需调用 requeue_frame 归还给驱动
+int dequeue_frame(struct v4l2_buffer *buf) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    struct timeval tv = { .tv_sec = 2, .tv_usec = 0 };
+
+    int r = select(fd + 1, &fds, NULL, NULL, &tv);
+    if (r == -1) {
+        if (errno == EINTR) return -1;
+        errno_exit("select");
+    }
+    if (r == 0) {
+        fprintf(stderr, "Timeout waiting for frame\n");
+        return -1;
+    }
+
+    CLEAR(*buf);
+    buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf->memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(fd, VIDIOC_DQBUF, buf) == -1) {
+        if (errno == EAGAIN) return -1;
+        errno_exit("VIDIOC_DQBUF");
+    }
+    return 0;
+}
+
+void requeue_frame(struct v4l2_buffer *buf) {
+    if (xioctl(fd, VIDIOC_QBUF, buf) == -1)
+        errno_exit("VIDIOC_QBUF");
+}
+
+// num_frames 为 0 时持续采集直到 Ctrl+C
+void capture_streaming(int num_frames, enum image_format fmt) {
+    if (num_frames > 0)
+        printf("Streaming %d frames at %dx%d resolution...\n", num_frames, WIDTH, HEIGHT);
+    else
+        printf("Streaming at %dx%d resolution until Ctrl+C...\n", WIDTH, HEIGHT);
+    printf("RGB pool: %d x %.2f MB\n", RGB_POOL_SIZE, (float)RGB_SIZE/(1024*1024));
+
+    if (frame_pool_init(&rgb_pool, RGB_POOL_SIZE, RGB_SIZE) != 0) {
+        fprintf(stderr, "Memory allocation failed for RGB pool\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct image_writer writer;
+    if (image_writer_start(&writer, &rgb_pool, fmt, WIDTH, HEIGHT, "frame", WRITER_THREADS) != 0) {
+        fprintf(stderr, "Cannot create writer threads\n");
+        exit(EXIT_FAILURE);
+    }
+
+    signal(SIGINT, handle_sigint);
+
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    int frames_converted = 0, frames_dropped = 0, frames_bad = 0;
+    while (!stop_requested && (num_frames == 0 || frames_converted < num_frames)) {
+        struct v4l2_buffer buf;
+        if (dequeue_frame(&buf) < 0)
+            continue;
+
+        if (buf.bytesused != IMAGE_SIZE) {
+            frames_bad++;
+            requeue_frame(&buf);
+            continue;
+        }
+
+        // 写盘线程跟不上时丢弃该帧，而不是阻塞采集
+        struct pool_frame *f = frame_pool_acquire(&rgb_pool, 0);
+        if (!f) {
+            frames_dropped++;
+            requeue_frame(&buf);
+            continue;
+        }
+
+        if (frames_converted == 0)
+            analyze_yuv_data(buffers[buf.index].start, buf.bytesused);
+
+        yuyv_to_rgb24(buffers[buf.index].start, f->data, WIDTH, HEIGHT);
+        requeue_frame(&buf);
+
+        f->size = RGB_SIZE;
+        f->sequence = frames_converted;
+        clock_gettime(CLOCK_MONOTONIC, &f->timestamp);
+        frame_pool_submit(&rgb_pool, f);
+        frames_converted++;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    frame_pool_close(&rgb_pool);
+    image_writer_join(&writer);
+    frame_pool_destroy(&rgb_pool);
+
+    double total_time = (end_time.tv_sec - start_time.tv_sec) +
+                       (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    printf("\nStreaming completed: %d frames converted in %.2f seconds (%.2f FPS)\n",
+           frames_converted, total_time, frames_converted / total_time);
+    printf("  Dropped (writer busy): %d, incomplete: %d\n", frames_dropped, frames_bad);
+    image_writer_print_summary(&writer);
+}
+
+// 采集结束后把已存储的帧转换为RGB，由后台线程并行编码写盘
+void convert_stored_frames(enum image_format fmt) {
+    if (frame_pool_init(&rgb_pool, RGB_POOL_SIZE, RGB_SIZE) != 0) {
+        fprintf(stderr, "Memory allocation failed for RGB conversion\n");
         return;
     }
-    
-    // PPM文件头
-    fprintf(fp, "P6\n%d %d\n255\n", width, height);
-    
-    // 写入RGB数据
-    size_t written = fwrite(rgb, 1, width * height * 3, fp);
-    if (written != width * height * 3) {
-        perror("Error writing PPM data");
+
+    struct image_writer writer;
+    if (image_writer_start(&writer, &rgb_pool, fmt, WIDTH, HEIGHT, "frame", WRITER_THREADS) != 0) {
+        fprintf(stderr, "Cannot create writer threads\n");
+        frame_pool_destroy(&rgb_pool);
+        return;
     }
-    
-    fclose(fp);
-    printf("Saved RGB image to %s (%dx%d)\n", filename, width, height);
+
+    for (int i = 0; i < frame_count; i++) {
+        if (frames[i].size != IMAGE_SIZE) {
+            printf("Frame %d has incorrect size (%zu), expected %d. Skip RGB conversion.\n", 
+                   i, frames[i].size, IMAGE_SIZE);
+            continue;
+        }
+
+        struct pool_frame *f = frame_pool_acquire(&rgb_pool, 1);
+        printf("Converting frame %d to RGB...\n", i);
+        yuyv_to_rgb24(frames[i].data, f->data, WIDTH, HEIGHT);
+        f->size = RGB_SIZE;
+        f->sequence = i;
+        f->timestamp = frames[i].timestamp;
+        frame_pool_submit(&rgb_pool, f);
+    }
+
+    frame_pool_close(&rgb_pool);
+    image_writer_join(&writer);
+    frame_pool_destroy(&rgb_pool);
+    image_writer_print_summary(&writer);
 }
 
 // ========================= 主函数 =========================
+// 用法: yuyvtorgb [帧数] [格式]        采集后统一转换（最多 MAX_FRAMES 帧）
+//       yuyvtorgb -s [帧数] [格式]     流式转换，帧数为 0 或省略时持续到 Ctrl+C
+// 格式: qoi（默认）/ png / ppm
 int main(int argc, char *argv[]) {
+    int streaming = (argc > 1 && strcmp(argv[1], "-s") == 0);
+    int argi = streaming ? 2 : 1;
+    
+    enum image_format fmt = IMG_QOI;
+    if (argc > argi + 1) {
+        int parsed = image_format_parse(argv[argi + 1]);
+        if (parsed < 0) {
+            fprintf(stderr, "Unknown output format: %s (use qoi, png or ppm)\n", argv[argi + 1]);
+            exit(EXIT_FAILURE);
+        }
+        fmt = parsed;
+    }
+    
     fd = open(DEVICE_NAME, O_RDWR | O_NONBLOCK, 0);
     if (fd == -1) {
         perror("Cannot open device");
@@ -373,6 +498,18 @@ int main(int argc, char *argv[]) {
     enqueue_buffers();
     start_capturing();
     
+    if (streaming) {
+        int num_frames = 0;
+        if (argc > argi) num_frames = atoi(argv[argi]);
+        if (num_frames < 0) num_frames = 0;
+        
+        capture_streaming(num_frames, fmt);
+        stop_capturing();
+        uninit_device();
+        close_device();
+        return 0;
+    }
+    
     int num_frames = 1; // 默认只捕获1帧（高分辨率转换耗时）
     if (argc > 1) num_frames = atoi(argv[1]);
     if (num_frames <= 0 || num_frames > MAX_FRAMES) num_frames = 1;
@@ -383,30 +520,7 @@ int main(int argc, char *argv[]) {
     close_device();
     
     // 转换并保存RGB图像
-    for (int i = 0; i < frame_count; i++) {
-        if (frames[i].size == IMAGE_SIZE) {
-            // 分配RGB缓冲区
-            unsigned char *rgb = malloc(WIDTH * HEIGHT * 3);
-            if (!rgb) {
-                fprintf(stderr, "Memory allocation failed for RGB conversion\n");
-                continue;
-            }
-            
-            // 转换YUV到RGB
-            printf("Converting frame %d to RGB...\n", i);
-            yuyv_to_rgb24(frames[i].data, rgb, WIDTH, HEIGHT);
-            
-            // 保存为PPM
-            char ppm_filename[50];
-            snprintf(ppm_filename, sizeof(ppm_filename), "frame_%d.ppm", i);
-            save_rgb_to_ppm(ppm_filename, rgb, WIDTH, HEIGHT);
-            
-            free(rgb);
-        } else {
-            printf("Frame %d has incorrect size (%zu), expected %d. Skip RGB conversion.\n", 
-                   i, frames[i].size, IMAGE_SIZE);
-        }
-    }
+    convert_stored_frames(fmt);
     
     free_frames();
     return 0;
@@ -0,0 +1,94 @@
+#pragma once
+
+// 堆分配计数（基准测试用）：替换全局 operator new/delete，并给 cv::Mat 装一个计数的默认分配器。
+// 两者相加就是实际的堆分配次数：Mat 的数据缓冲走 fastMalloc，不经过 operator new，
+// 而它的 UMatData 头部是 new 出来的，会计入 new 次数。
+// 替换 operator new 对整个程序（包括 OpenCV、Tesseract 等共享库）生效，每次分配多两次原子加，
+// 所以只在编译时定义 OCR_ALLOC_COUNT 才启用（make bench 生成 ocr_bench），正常构建时计数恒为 0；
+// 启用时这个头文件只能被一个源文件包含。
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef OCR_ALLOC_COUNT
+#define ALLOC_COUNT_ENABLED 1
+
+static std::atomic<uint64_t> g_new_count{0};
+static std::atomic<uint64_t> g_new_bytes{0};
+static std::atomic<uint64_t> g_mat_count{0};
+
+void* operator new(size_t size) {
+    g_new_count.fetch_add(1, std::memory_order_relaxed);
+    g_new_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    g_new_count.fetch_add(1, std::memory_order_relaxed);
+    g_new_bytes.fetch_add(size, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// 转发给 OpenCV 自带的分配器，只多一次计数；释放时 UMatData 记录的是原分配器，不经过这里
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    CountingMatAllocator() : base(cv::Mat::getStdAllocator()) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+        g_mat_count.fetch_add(1, std::memory_order_relaxed);
+        return base->allocate(dims, sizes, type, data, step, flags, usage);
+    }
+    bool allocate(cv::UMatData* data, cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+        return base->allocate(data, flags, usage);
+    }
+    void deallocate(cv::UMatData* data) const override { base->deallocate(data); }
+
+private:
+    cv::MatAllocator* base;
+};
+#else
+#define ALLOC_COUNT_ENABLED 0
+#endif
+
+struct AllocSnapshot {
+    uint64_t news = 0;
+    uint64_t bytes = 0;
+    uint64_t mats = 0;
+
+    static AllocSnapshot now() {
+        AllocSnapshot s;
+#if ALLOC_COUNT_ENABLED
+        s.news = g_new_count.load(std::memory_order_relaxed);
+        s.bytes = g_new_bytes.load(std::memory_order_relaxed);
+        s.mats = g_mat_count.load(std::memory_order_relaxed);
+#endif
+        return s;
+    }
+    uint64_t total() const { return news + mats; }
+};
+
+static inline AllocSnapshot operator-(const AllocSnapshot& a, const AllocSnapshot& b) {
+    AllocSnapshot d;
+    d.news = a.news - b.news;
+    d.bytes = a.bytes - b.bytes;
+    d.mats = a.mats - b.mats;
+    return d;
+}
+
+// 开始统计 Mat 分配（进程内只需调用一次）
+static inline void install_mat_alloc_counter() {
+#if ALLOC_COUNT_ENABLED
+    static CountingMatAllocator allocator;
+    cv::Mat::setDefaultAllocator(&allocator);
+#endif
+}
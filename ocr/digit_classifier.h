@@ -0,0 +1,170 @@
+#pragma once
+
+// 单字符数字的快速分类器（模板匹配 / 最近邻）：
+// 二值 ROI 裁到前景外接框，按比例缩放居中到 16x16，减均值后做 L2 归一化，
+// 和所有训练模板做点积（即归一化相关系数），取得分最高的模板的类别。
+// 置信度看最高分和“第二好的其他类别”之间的差距，不够确定时交给 Tesseract。
+// 模型文件: "DGT1" + 边长 + 模板数，随后每个模板 1 字节类别 + 边长^2 个 float。
+
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define DIGIT_SIDE 16
+#define DIGIT_DIM (DIGIT_SIDE * DIGIT_SIDE)
+
+struct DigitResult {
+    int digit = -1;       // 0-9，没有模板时为 -1
+    float score = 0;      // 与最佳模板的相关系数（-1..1）
+    float margin = 0;     // 与第二好的其他数字之差
+};
+
+// 点积：NEON 上 4 路并行累加，其他平台交给编译器自动向量化
+static inline float digit_dot(const float* a, const float* b) {
+#if defined(__ARM_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+    float32x4_t acc2 = vdupq_n_f32(0), acc3 = vdupq_n_f32(0);
+    for (int i = 0; i < DIGIT_DIM; i += 16) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        acc2 = vfmaq_f32(acc2, vld1q_f32(a + i + 8), vld1q_f32(b + i + 8));
+        acc3 = vfmaq_f32(acc3, vld1q_f32(a + i + 12), vld1q_f32(b + i + 12));
+    }
+    return vaddvq_f32(vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3)));
+#else
+    float sum = 0;
+    for (int i = 0; i < DIGIT_DIM; ++i) sum += a[i] * b[i];
+    return sum;
+#endif
+}
+
+class DigitClassifier {
+public:
+    float min_score = 0.6f;    // 低于该相关系数不信任
+    float min_margin = 0.05f;  // 和其他数字太接近也不信任
+
+    // 二值 ROI（前景非零）转成特征向量，前景为空时返回 false
+    static bool features(const cv::Mat& bin, float* out) {
+        cv::Rect box = cv::boundingRect(bin);
+        if (box.width == 0 || box.height == 0) return false;
+        // 按长边缩放到 DIGIT_SIDE-2，四周留一像素，保持宽高比
+        const int inner = DIGIT_SIDE - 2;
+        double scale = double(inner) / std::max(box.width, box.height);
+        int w = std::max(1, int(std::lround(box.width * scale)));
+        int h = std::max(1, int(std::lround(box.height * scale)));
+        uint8_t pixels[DIGIT_DIM] = {};
+        cv::Mat canvas(DIGIT_SIDE, DIGIT_SIDE, CV_8UC1, pixels);   // 栈上缓冲，不分配
+        cv::Mat dst = canvas(cv::Rect((DIGIT_SIDE - w) / 2, (DIGIT_SIDE - h) / 2, w, h));
+        cv::resize(bin(box), dst, cv::Size(w, h), 0, 0, cv::INTER_AREA);
+
+        float mean = 0;
+        for (int y = 0; y < DIGIT_SIDE; ++y) {
+            const uint8_t* row = canvas.ptr<uint8_t>(y);
+            for (int x = 0; x < DIGIT_SIDE; ++x) mean += (out[y * DIGIT_SIDE + x] = row[x]);
+        }
+        mean /= DIGIT_DIM;
+        float norm = 0;
+        for (int i = 0; i < DIGIT_DIM; ++i) {
+            out[i] -= mean;
+            norm += out[i] * out[i];
+        }
+        if (norm <= 0) return false;
+        float inv = 1.0f / std::sqrt(norm);
+        for (int i = 0; i < DIGIT_DIM; ++i) out[i] *= inv;
+        return true;
+    }
+
+    void add(int digit, const float* f) {
+        labels.push_back(uint8_t(digit));
+        templates.insert(templates.end(), f, f + DIGIT_DIM);
+    }
+
+    size_t size() const { return labels.size(); }
+
+    DigitResult classify(const float* f) const {
+        float best[10];
+        for (float& b : best) b = -2;
+        for (size_t i = 0; i < labels.size(); ++i) {
+            float s = digit_dot(f, &templates[i * DIGIT_DIM]);
+            if (s > best[labels[i]]) best[labels[i]] = s;
+        }
+        // 每个数字取最相似的模板，再比较最好和第二好的数字
+        int first = -1, second = -1;
+        for (int d = 0; d < 10; ++d) {
+            if (best[d] < -1.5f) continue;   // 该数字没有模板
+            if (first < 0 || best[d] > best[first]) {
+                second = first;
+                first = d;
+            } else if (second < 0 || best[d] > best[second]) {
+                second = d;
+            }
+        }
+        DigitResult r;
+        if (first < 0) return r;
+        r.digit = first;
+        r.score = best[first];
+        r.margin = second >= 0 ? best[first] - best[second] : 1;
+        return r;
+    }
+
+    bool confident(const DigitResult& r) const {
+        return r.digit >= 0 && r.score >= min_score && r.margin >= min_margin;
+    }
+
+    bool save(const char* path) const {
+        FILE* fp = fopen(path, "wb");
+        if (!fp) {
+            perror(path);
+            return false;
+        }
+        uint32_t header[2] = {DIGIT_SIDE, uint32_t(labels.size())};
+        bool ok = fwrite("DGT1", 1, 4, fp) == 4 && fwrite(header, sizeof(header), 1, fp) == 1;
+        for (size_t i = 0; ok && i < labels.size(); ++i) {
+            ok = fwrite(&labels[i], 1, 1, fp) == 1 &&
+                 fwrite(&templates[i * DIGIT_DIM], sizeof(float), DIGIT_DIM, fp) == DIGIT_DIM;
+        }
+        if (fclose(fp) != 0) ok = false;
+        if (!ok) perror(path);
+        return ok;
+    }
+
+    bool load(const char* path) {
+        FILE* fp = fopen(path, "rb");
+        if (!fp) {
+            perror(path);
+            return false;
+        }
+        char magic[4];
+        uint32_t header[2];
+        bool ok = fread(magic, 1, 4, fp) == 4 && memcmp(magic, "DGT1", 4) == 0 &&
+                  fread(header, sizeof(header), 1, fp) == 1 && header[0] == DIGIT_SIDE && header[1] < (1u << 20);
+        labels.clear();
+        templates.clear();
+        if (ok) {
+            labels.resize(header[1]);
+            templates.resize(size_t(header[1]) * DIGIT_DIM);
+            for (size_t i = 0; ok && i < labels.size(); ++i) {
+                ok = fread(&labels[i], 1, 1, fp) == 1 && labels[i] < 10 &&
+                     fread(&templates[i * DIGIT_DIM], sizeof(float), DIGIT_DIM, fp) == DIGIT_DIM;
+            }
+        }
+        fclose(fp);
+        if (!ok) {
+            fprintf(stderr, "%s: 不是有效的数字模型文件\n", path);
+            labels.clear();
+            templates.clear();
+        }
+        return ok;
+    }
+
+private:
+    std::vector<uint8_t> labels;
+    std::vector<float> templates;   // 每个模板 DIGIT_DIM 个 float，已归一化
+};
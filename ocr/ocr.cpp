@@ -10,23 +10,94 @@
 #include <iomanip>
 #include <sstream>
 #include <cctype>
-// 轮廓排序比较函数（从左到右）
-bool sortContours(const std::vector<cv::Point>& c1, const std::vector<cv::Point>& c2) {
-    cv::Rect rect1 = cv::boundingRect(c1);
-    cv::Rect rect2 = cv::boundingRect(c2);
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <dirent.h>
+#include <getopt.h>
+#include <unistd.h>
+#include "tess_pool.h"
+#include "digit_classifier.h"
+#include "roi_cache.h"
+#include "roi_tracker.h"
+#include "ocr_workspace.h"
+#include "alloc_counter.h"
+
+#define ARENA_BYTES (4 << 20)   // 每帧 ROI 临时图像的总容量
+#define BENCH_WARMUP 10         // 基准测试中不计入统计的预热帧数（缓冲在这期间长到稳定大小）
+
+// 一个候选数字区域
+struct DigitRoi {
+    cv::Rect rect;      // 扩展后的区域（原图坐标）
+    cv::Mat bin;        // 二值化的 ROI（前景为白）
+    std::string fast;   // 分类器有把握时的结果
+    int guess = -1;     // 分类器的最佳猜测（不论置信度），用于 -A 统计
+    uint64_t signature = 0;  // 缓存签名
+    bool cached = false;     // 结果来自上一帧的缓存
+    char stripDigit = 0;     // -B：拼条中归到这一格的字符及其置信度
+    float stripConfidence = -1;
+    std::string text;   // 识别出的单个数字，识别失败为空
+};
+
+// 一帧识别用到的所有缓冲，按帧尺寸初始化一次后跨帧复用（vector 只 clear 不释放），
+// 稳态下我们自己的代码每帧不再分配堆内存
+struct OcrWorkspace {
+    PreprocessWorkspace pre;
+    ScratchArena arena;           // ROI 的灰度、二值、缩放图像和拼条，每帧开始时清空
+    std::vector<DigitRoi> rois;
+    std::vector<char> pending;
+    std::vector<size_t> waiting;
+    std::vector<std::vector<size_t>> batches;
+    std::vector<cv::Rect> candidates, windows, found;
+    
+    void init(const cv::Size& frame) {
+        pre.init(frame);
+        arena.init(ARENA_BYTES);
+    }
+};
+
+// 快速分类器（-m 加载）：置信度够高的 ROI 不再调用 Tesseract
+DigitClassifier classifier;
+bool evaluateClassifier = false;  // -A：分类器有结果时也跑 Tesseract，统计两者一致率
+const char* dumpDir = nullptr;    // -D：把二值 ROI 按 Tesseract 的结果存成训练样本
+bool batchTesseract = false;      // -B：一帧中需要 Tesseract 的 ROI 拼成一行，一次识别
+RoiCache roiCache;                // 没有变化的 ROI 沿用上一帧的结果（-R 设置刷新间隔，0 关闭）
+RoiTracker tracker;               // -N：全帧检测之间只处理上次数字周围的窗口
+
+// 识别线程并发更新的统计
+struct ClassifierStats {
+    std::atomic<int> fast{0};          // 分类器直接给出结果
+    std::atomic<int> fallback{0};      // 置信度不够，交给 Tesseract
+    std::atomic<int64_t> classifyNs{0};
+    std::atomic<int> tessCalls{0};
+    std::atomic<int64_t> tessNs{0};
+    std::atomic<int> compared{0};      // -A：分类器有把握且 Tesseract 也有结果
+    std::atomic<int> agreed{0};
+    std::atomic<int> allCompared{0};   // -A：不论置信度，两边都有结果
+    std::atomic<int> allAgreed{0};
+    std::atomic<int> dumped{0};
+    std::atomic<int> batchedRois{0};   // -B：经由拼条识别的 ROI 数（tessCalls 计拼条次数）
+    std::atomic<int> recognized{0};    // 没有命中缓存、真正识别的 ROI 数
+};
+ClassifierStats classifierStats;
+
+// 区域排序比较函数（从左到右）
+bool sortRects(const cv::Rect& rect1, const cv::Rect& rect2) {
     return rect1.x < rect2.x;
 }
 
-// 预处理图像以增强数字区域
-cv::Mat preprocessImage(const cv::Mat& input) {
-    cv::Mat gray, blurred, clahe_out, edged;
+// 预处理图像以增强数字区域。input 是整帧或帧中的窗口，中间结果写在工作区缓冲左上角
+// 同样大小的视图里（尺寸相同时 OpenCV 不会重新分配），返回的边缘图在下次调用前有效
+cv::Mat preprocessImage(const cv::Mat& input, PreprocessWorkspace& ws) {
+    cv::Rect area(0, 0, input.cols, input.rows);
+    cv::Mat gray = ws.gray(area), clahe_out = ws.equalized(area);
+    cv::Mat blurred = ws.blurred(area), edged = ws.edged(area);
     
     // 转换为灰度图
     cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
     
     // 应用自适应直方图均衡化
-    cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(2.0, cv::Size(8, 8));
-    clahe->apply(gray, clahe_out);
+    ws.clahe->apply(gray, clahe_out);
     
     // 高斯模糊减少噪声
     cv::GaussianBlur(clahe_out, blurred, cv::Size(5, 5), 0);
@@ -35,90 +106,297 @@ cv::Mat preprocessImage(const cv::Mat& input) {
     cv::Canny(blurred, edged, 30, 150);
     
     // 形态学操作（闭运算连接边缘）
-    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
-    cv::morphologyEx(edged, edged, cv::MORPH_CLOSE, kernel);
+    cv::morphologyEx(edged, edged, cv::MORPH_CLOSE, ws.kernel);
     
     return edged;
 }
 
-// 识别数字并返回结果
-std::vector<std::pair<std::string, cv::Point>> recognizeDigits(
-    cv::Mat& frame, cv::Mat& processed, tesseract::TessBaseAPI& ocr) {
+// 用 Tesseract 识别二值 ROI，返回第一个数字字符（没有则为空）
+std::string tesseractDigit(const cv::Mat& binRoi, tesseract::TessBaseAPI& ocr, ScratchArena& arena) {
+    // 调整大小以提高OCR识别率
+    cv::Mat resizedRoi = arena.mat(100, 100, CV_8UC1);
+    cv::resize(binRoi, resizedRoi, cv::Size(100, 100), 0, 0, cv::INTER_AREA);
+    
+    // 使用Tesseract进行OCR识别
+    ocr.SetImage(resizedRoi.data, resizedRoi.cols, resizedRoi.rows, 1, resizedRoi.step);
+    char* text = ocr.GetUTF8Text();
+    std::string digitText(text ? text : "");
+    delete[] text;
+    
+    // 清理文本
+    digitText.erase(std::remove(digitText.begin(), digitText.end(), '\n'), digitText.end());
+    digitText.erase(std::remove(digitText.begin(), digitText.end(), ' '), digitText.end());
+    
+    // 如果识别结果为单个数字，则返回该数字
+    if (!digitText.empty() && std::isdigit(static_cast<unsigned char>(digitText[0])))
+        return digitText.substr(0, 1);
+    return std::string();
+}
+
+// 二值化 ROI，先查缓存再用快速分类器，返回是否还需要 Tesseract
+bool classifyRoi(const cv::Mat& roi, DigitRoi& out, ScratchArena& arena) {
+    cv::Mat grayRoi = arena.mat(roi.rows, roi.cols, CV_8UC1);
+    cv::cvtColor(roi, grayRoi, cv::COLOR_BGR2GRAY);
+    
+    // 二值化
+    out.bin = arena.mat(roi.rows, roi.cols, CV_8UC1);
+    cv::threshold(grayRoi, out.bin, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+    
+    if (roiCache.enabled()) {
+        out.signature = roi_signature(out.bin);
+        if (roiCache.lookup(out.rect, out.signature, &out.text)) {
+            out.cached = true;
+            return false;
+        }
+    }
+    classifierStats.recognized++;
+    
+    if (classifier.size() > 0) {
+        auto t0 = std::chrono::steady_clock::now();
+        float features[DIGIT_DIM];
+        if (DigitClassifier::features(out.bin, features)) {
+            DigitResult r = classifier.classify(features);
+            out.guess = r.digit;
+            if (classifier.confident(r)) out.fast.assign(1, char('0' + r.digit));
+        }
+        classifierStats.classifyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        if (!out.fast.empty()) classifierStats.fast++;
+        else classifierStats.fallback++;
+        if (!out.fast.empty() && !evaluateClassifier && !dumpDir) {
+            out.text = out.fast;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 收到 Tesseract 的结果后：导出样本、统计一致率，分类器有把握时仍以分类器为准
+void finishRoi(DigitRoi& roi, const std::string& tessText) {
+    if (dumpDir && !tessText.empty()) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%c_%06d.png", dumpDir, tessText[0], classifierStats.dumped++);
+        cv::imwrite(path, roi.bin);
+    }
+    if (evaluateClassifier && !tessText.empty() && roi.guess >= 0) {
+        bool same = tessText[0] == char('0' + roi.guess);
+        classifierStats.allCompared++;
+        if (same) classifierStats.allAgreed++;
+        if (!roi.fast.empty()) {
+            classifierStats.compared++;
+            if (same) classifierStats.agreed++;
+        }
+    }
+    roi.text = roi.fast.empty() ? tessText : roi.fast;
+}
+
+// 拼条布局：每个 ROI 按比例缩放进一个格子，格子之间留出足够宽的空白，
+// Tesseract 不会把相邻格子里的笔画连成一个字符；识别后按字符框中心所在的格子归位
+#define STRIP_CELL_W 40
+#define STRIP_CELL_H 48
+#define STRIP_GAP 24
+#define STRIP_MARGIN 16
+
+// 把 rois 中 indices 指定的 ROI 拼成一行白底黑字的图像，一次 Recognize，
+// 再用 ResultIterator 的字符框把结果分回各 ROI（每格取置信度最高的字符）
+void recognizeStrip(tesseract::TessBaseAPI& ocr, std::vector<DigitRoi>& rois, const std::vector<size_t>& indices,
+                    ScratchArena& arena) {
+    const int pitch = STRIP_CELL_W + STRIP_GAP;
+    const int rows = STRIP_CELL_H + 2 * STRIP_MARGIN;
+    const int cols = 2 * STRIP_MARGIN + int(indices.size()) * pitch - STRIP_GAP;
+    cv::Mat strip = arena.mat(rows, cols, CV_8UC1);
+    if (strip.empty()) strip.create(rows, cols, CV_8UC1);   // 临时区不够时退回堆分配
+    strip.setTo(cv::Scalar(255));
+    for (size_t k = 0; k < indices.size(); ++k) {
+        DigitRoi& roi = rois[indices[k]];
+        roi.stripDigit = 0;
+        roi.stripConfidence = -1;
+        const cv::Mat& bin = roi.bin;
+        double scale = std::min(double(STRIP_CELL_W) / bin.cols, double(STRIP_CELL_H) / bin.rows);
+        int w = std::max(1, int(bin.cols * scale));
+        int h = std::max(1, int(bin.rows * scale));
+        cv::Mat cell = strip(cv::Rect(STRIP_MARGIN + int(k) * pitch + (STRIP_CELL_W - w) / 2,
+                                      STRIP_MARGIN + (STRIP_CELL_H - h) / 2, w, h));
+        cv::resize(bin, cell, cv::Size(w, h), 0, 0, cv::INTER_AREA);
+        cv::bitwise_not(cell, cell);
+    }
     
-    std::vector<std::pair<std::string, cv::Point>> results;
-    std::vector<std::vector<cv::Point>> contours;
-    std::vector<cv::Vec4i> hierarchy;
+    auto t0 = std::chrono::steady_clock::now();
+    ocr.SetPageSegMode(tesseract::PSM_SINGLE_LINE);
+    ocr.SetImage(strip.data, strip.cols, strip.rows, 1, strip.step);
+    if (ocr.Recognize(nullptr) == 0) {
+        tesseract::ResultIterator* it = ocr.GetIterator();
+        if (it) {
+            do {
+                if (it->Empty(tesseract::RIL_SYMBOL)) continue;
+                int x1, y1, x2, y2;
+                if (!it->BoundingBox(tesseract::RIL_SYMBOL, &x1, &y1, &x2, &y2)) continue;
+                int k = ((x1 + x2) / 2 - STRIP_MARGIN + STRIP_GAP / 2) / pitch;
+                if (k < 0 || k >= int(indices.size())) continue;
+                char* symbol = it->GetUTF8Text(tesseract::RIL_SYMBOL);
+                float conf = it->Confidence(tesseract::RIL_SYMBOL);
+                DigitRoi& roi = rois[indices[k]];
+                if (symbol && std::isdigit(static_cast<unsigned char>(symbol[0])) && conf > roi.stripConfidence) {
+                    roi.stripDigit = symbol[0];
+                    roi.stripConfidence = conf;
+                }
+                delete[] symbol;
+            } while (it->Next(tesseract::RIL_SYMBOL));
+            delete it;
+        }
+    }
+    ocr.SetPageSegMode(tesseract::PSM_SINGLE_CHAR);   // 实例池默认的单字符模式
+    classifierStats.tessNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    classifierStats.tessCalls++;
+    classifierStats.batchedRois += int(indices.size());
     
-    // 查找轮廓
-    cv::findContours(processed.clone(), contours, hierarchy, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    for (size_t index : indices) {
+        DigitRoi& roi = rois[index];
+        finishRoi(roi, std::string(roi.stripDigit ? 1 : 0, roi.stripDigit));
+    }
+}
+
+// 从目录训练分类器：文件名首字符是数字标签（即 -D 导出的 <数字>_<序号>.png，人工检查过）
+bool trainClassifier(const char* dir, const char* modelPath) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return false;
+    }
+    DigitClassifier model;
+    int counts[10] = {0};
+    float features[DIGIT_DIM];
+    while (dirent* entry = readdir(d)) {
+        if (!std::isdigit(static_cast<unsigned char>(entry->d_name[0]))) continue;
+        cv::Mat image = cv::imread(std::string(dir) + "/" + entry->d_name, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) continue;
+        cv::Mat binRoi;
+        cv::threshold(image, binRoi, 127, 255, cv::THRESH_BINARY);
+        if (!DigitClassifier::features(binRoi, features)) continue;
+        int digit = entry->d_name[0] - '0';
+        model.add(digit, features);
+        counts[digit]++;
+    }
+    closedir(d);
+    
+    std::cout << "训练样本 " << model.size() << " 个:";
+    for (int i = 0; i < 10; ++i) std::cout << " " << i << "=" << counts[i];
+    std::cout << std::endl;
+    if (model.size() == 0) {
+        std::cerr << dir << " 中没有可用的样本" << std::endl;
+        return false;
+    }
+    return model.save(modelPath);
+}
+
+// 在预处理后的边缘图中查找可能的数字区域，加上 offset（窗口左上角）换算成原图坐标
+void findDigitRects(const cv::Mat& processed, const cv::Point& offset, std::vector<cv::Rect>& rects,
+                    PreprocessWorkspace& ws) {
+    // 查找轮廓（OpenCV 3.2 起不再修改输入图像，不必先拷贝）
+    cv::findContours(processed, ws.contours, ws.hierarchy, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
     
     // 过滤轮廓
-    std::vector<std::vector<cv::Point>> digitContours;
-    for (const auto& contour : contours) {
+    for (const auto& contour : ws.contours) {
         cv::Rect rect = cv::boundingRect(contour);
         double area = cv::contourArea(contour);
         double aspectRatio = static_cast<double>(rect.width) / rect.height;
         
         // 根据面积和宽高比过滤可能的数字区域
         if (area > 300 && area < 10000 && aspectRatio > 0.2 && aspectRatio < 1.2) {
-            digitContours.push_back(contour);
+            rect.x += offset.x;
+            rect.y += offset.y;
+            rects.push_back(rect);
         }
     }
+}
+
+// 识别 ws.candidates 中的候选区域，结果写入 results；识别出数字的区域写入 ws.found（供跟踪使用）
+void recognizeDigits(cv::Mat& frame, TessPool& pool, OcrWorkspace& ws,
+                     std::vector<std::pair<std::string, cv::Point>>& results) {
+    results.clear();
+    ws.found.clear();
+    ws.arena.reset();
     
-    // 按从左到右排序轮廓
-    std::sort(digitContours.begin(), digitContours.end(), sortContours);
+    // 按从左到右排序
+    std::vector<cv::Rect>& candidates = ws.candidates;
+    std::sort(candidates.begin(), candidates.end(), sortRects);
     
-    // 处理每个可能的数字区域
-    for (const auto& contour : digitContours) {
-        cv::Rect rect = cv::boundingRect(contour);
-        
-        // 扩展区域以确保包含整个数字
+    // 扩展区域以确保包含整个数字
+    std::vector<DigitRoi>& rois = ws.rois;
+    rois.resize(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        cv::Rect rect = candidates[i];
         int padding = 8;
         rect.x = std::max(0, rect.x - padding);
         rect.y = std::max(0, rect.y - padding);
         rect.width = std::min(frame.cols - rect.x, rect.width + 2 * padding);
         rect.height = std::min(frame.rows - rect.y, rect.height + 2 * padding);
-        
-        // 提取ROI
-        cv::Mat roi = frame(rect);
-        cv::Mat grayRoi;
-        cv::cvtColor(roi, grayRoi, cv::COLOR_BGR2GRAY);
-        
-        // 二值化
-        cv::Mat binRoi;
-        cv::threshold(grayRoi, binRoi, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
-        
-        // 调整大小以提高OCR识别率
-        cv::Mat resizedRoi;
-        cv::resize(binRoi, resizedRoi, cv::Size(100, 100), 0, 0, cv::INTER_AREA);
-        
-        // 使用Tesseract进行OCR识别
-        ocr.SetImage(resizedRoi.data, resizedRoi.cols, resizedRoi.rows, 1, resizedRoi.step);
-        char* text = ocr.GetUTF8Text();
-        std::string digitText(text);
-        
-        // 清理文本
-        digitText.erase(std::remove(digitText.begin(), digitText.end(), '\n'), digitText.end());
-        digitText.erase(std::remove(digitText.begin(), digitText.end(), ' '), digitText.end());
-        
-        // 如果识别结果为单个数字，则保存结果
-        if (!digitText.empty() && std::isdigit(static_cast<unsigned char>(digitText[0]))) {
-            cv::Point center(rect.x + rect.width / 2, rect.y + rect.height / 2);
-            results.push_back({digitText.substr(0, 1), center});
-            
-            // 在原始图像上绘制结果
-            cv::rectangle(frame, rect, cv::Scalar(0, 255, 0), 2);
-            cv::circle(frame, center, 5, cv::Scalar(0, 0, 255), -1);
-            
-            std::string label = digitText + " @(" + std::to_string(center.x) + "," + std::to_string(center.y) + ")";
-            cv::putText(frame, label, cv::Point(rect.x, rect.y - 10), 
-                       cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 0, 255), 2);
+        DigitRoi& roi = rois[i];
+        roi.rect = rect;
+        roi.bin.release();
+        roi.fast.clear();
+        roi.guess = -1;
+        roi.cached = false;
+        roi.text.clear();
+    }
+    
+    // 各 ROI 分给实例池并行识别；识别期间只读 frame 和缓存，画框和更新缓存留到全部完成之后
+    if (roiCache.enabled()) roiCache.begin_frame();
+    std::vector<char>& pending = ws.pending;
+    pending.assign(rois.size(), 0);
+    pool.for_each(rois.size(), [&](tesseract::TessBaseAPI& ocr, size_t i) {
+        pending[i] = classifyRoi(frame(rois[i].rect), rois[i], ws.arena);
+        if (!pending[i] || batchTesseract) return;
+        auto t0 = std::chrono::steady_clock::now();
+        std::string text = tesseractDigit(rois[i].bin, ocr, ws.arena);
+        classifierStats.tessNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        classifierStats.tessCalls++;
+        finishRoi(rois[i], text);
+    });
+    
+    // -B：还需要 Tesseract 的 ROI 按顺序分成不超过实例数的几组，每组拼成一条识别一次
+    if (batchTesseract) {
+        std::vector<size_t>& waiting = ws.waiting;
+        waiting.clear();
+        for (size_t i = 0; i < rois.size(); ++i)
+            if (pending[i]) waiting.push_back(i);
+        size_t groups = std::min(waiting.size(), size_t(pool.size()));
+        if (ws.batches.size() < size_t(pool.size())) ws.batches.resize(pool.size());
+        for (size_t g = 0; g < groups; ++g) ws.batches[g].clear();
+        for (size_t k = 0; k < waiting.size(); ++k) ws.batches[k * groups / waiting.size()].push_back(waiting[k]);
+        pool.for_each(groups, [&](tesseract::TessBaseAPI& ocr, size_t g) {
+            recognizeStrip(ocr, rois, ws.batches[g], ws.arena);
+        });
+    }
+    
+    // 更新缓存（包括没识别出数字的 ROI，下一帧同样不必再识别）
+    if (roiCache.enabled()) {
+        for (const DigitRoi& roi : rois) {
+            if (roi.cached) roiCache.touch(roi.rect);
+            else roiCache.store(roi.rect, roi.signature, roi.text);
         }
-        
-        delete[] text;
+        roiCache.end_frame();
     }
     
-    return results;
+    // 按从左到右的顺序汇总结果
+    for (const DigitRoi& roi : rois) {
+        if (roi.text.empty()) continue;
+        const cv::Rect& rect = roi.rect;
+        cv::Point center(rect.x + rect.width / 2, rect.y + rect.height / 2);
+        results.emplace_back(roi.text, center);
+        ws.found.push_back(rect);
+        
+        // 在原始图像上绘制结果
+        cv::rectangle(frame, rect, cv::Scalar(0, 255, 0), 2);
+        cv::circle(frame, center, 5, cv::Scalar(0, 0, 255), -1);
+        
+        char label[64];
+        snprintf(label, sizeof(label), "%s @(%d,%d)", roi.text.c_str(), center.x, center.y);
+        cv::putText(frame, label, cv::Point(rect.x, rect.y - 10), 
+                   cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 0, 255), 2);
+    }
 }
 
 // 屏幕坐标映射函数
@@ -128,7 +406,225 @@ cv::Point mapToScreen(const cv::Point& cameraPoint, const cv::Size& cameraRes, c
     return cv::Point(screenX, screenY);
 }
 
-int main() {
+// 逐帧耗时和分配统计（基准测试只累计预热之后的帧）
+struct FrameStats {
+    int frames = 0;
+    double preprocessMs = 0;        // 预处理和查找轮廓的耗时
+    double ocrMs = 0;               // 识别耗时（不含预处理）
+    double processedPixels = 0;     // 预处理过的像素数（跟踪模式下只算窗口）
+    double framePixels = 0;
+    AllocSnapshot preprocessAllocs; // 仅在 OCR_ALLOC_COUNT 构建中有意义
+    AllocSnapshot ocrAllocs;
+};
+
+static void accumulate(AllocSnapshot& total, const AllocSnapshot& delta) {
+    total.news += delta.news;
+    total.bytes += delta.bytes;
+    total.mats += delta.mats;
+}
+
+// 处理一帧：预处理、查找候选区域、识别，并更新跟踪窗口；识别结果写入 digits
+void processFrame(cv::Mat& frame, TessPool& pool, OcrWorkspace& ws,
+                  std::vector<std::pair<std::string, cv::Point>>& digits, FrameStats& stats) {
+    ws.init(frame.size());
+    
+    // 预处理图像并查找候选区域：跟踪时只处理上次数字周围的窗口，否则处理整帧
+    AllocSnapshot a0 = AllocSnapshot::now();
+    auto preStart = std::chrono::steady_clock::now();
+    ws.candidates.clear();
+    ws.windows.clear();
+    if (tracker.tracking()) {
+        tracker.windows(frame.size(), ws.windows);
+        for (const cv::Rect& window : ws.windows) {
+            cv::Mat processed = preprocessImage(frame(window), ws.pre);
+            findDigitRects(processed, window.tl(), ws.candidates, ws.pre);
+            stats.processedPixels += window.area();
+        }
+    } else {
+        cv::Mat processed = preprocessImage(frame, ws.pre);
+        findDigitRects(processed, cv::Point(0, 0), ws.candidates, ws.pre);
+        stats.processedPixels += frame.size().area();
+    }
+    stats.framePixels += frame.size().area();
+    auto ocrStart = std::chrono::steady_clock::now();
+    AllocSnapshot a1 = AllocSnapshot::now();
+    stats.preprocessMs += std::chrono::duration<double, std::milli>(ocrStart - preStart).count();
+    
+    // 识别数字
+    recognizeDigits(frame, pool, ws, digits);
+    stats.ocrMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ocrStart).count();
+    accumulate(stats.preprocessAllocs, a1 - a0);
+    accumulate(stats.ocrAllocs, AllocSnapshot::now() - a1);
+    stats.frames++;
+    tracker.update(ws.found, ws.windows);
+    for (const cv::Rect& window : ws.windows) cv::rectangle(frame, window, cv::Scalar(255, 0, 0), 1);
+}
+
+void printSummary(const FrameStats& stats, const TessPool& pool) {
+    const int ocrFrames = stats.frames;
+    if (ocrFrames > 0)
+        std::cout << "平均每帧识别耗时: " << std::fixed << std::setprecision(1) << stats.ocrMs / ocrFrames
+                  << " ms（" << pool.size() << " 个实例）" << std::endl;
+    if (ocrFrames > 0)
+        std::cout << "平均每帧预处理耗时: " << stats.preprocessMs / ocrFrames << " ms，处理像素占整帧 "
+                  << 100.0 * stats.processedPixels / stats.framePixels << "%" << std::endl;
+    if (tracker.full_interval > 0)
+        std::cout << "跟踪: 全帧检测 " << tracker.full_frames << " 帧，窗口 " << tracker.tracked_frames
+                  << " 帧，窗口丢失数字 " << tracker.lost_count << " 次" << std::endl;
+    const ClassifierStats& cs = classifierStats;
+    if (ocrFrames > 0) {
+        std::cout << "平均每帧识别 " << std::setprecision(1) << double(cs.recognized) / ocrFrames << " 个 ROI，调用 Tesseract "
+                  << double(cs.tessCalls) / ocrFrames << " 次" << std::endl;
+        if (roiCache.lookup_count() > 0)
+            std::cout << "ROI 缓存命中率: " << 100.0 * roiCache.hit_count() / roiCache.lookup_count() << "%（"
+                      << roiCache.hit_count() << "/" << roiCache.lookup_count() << "，每 " << roiCache.refresh_frames
+                      << " 帧强制刷新）" << std::endl;
+    }
+    if (classifier.size() > 0) {
+        int classified = cs.fast + cs.fallback;
+        std::cout << "快速分类器: " << cs.fast << " 个直接给出结果，" << cs.fallback << " 个交给 Tesseract，平均 "
+                  << std::setprecision(1) << (classified ? cs.classifyNs / 1000.0 / classified : 0.0) << " us/个" << std::endl;
+    }
+    if (cs.tessCalls > 0)
+        std::cout << "Tesseract: " << cs.tessCalls << " 次，平均 " << std::setprecision(2)
+                  << cs.tessNs / 1e6 / cs.tessCalls << " ms/次" << std::endl;
+    if (cs.batchedRois > 0)
+        std::cout << "拼条识别: 平均每次 " << std::setprecision(1) << double(cs.batchedRois) / cs.tessCalls
+                  << " 个 ROI" << std::endl;
+    if (evaluateClassifier && cs.allCompared > 0)
+        std::cout << "与 Tesseract 一致率: 有把握的 " << cs.agreed << "/" << cs.compared << "（"
+                  << std::setprecision(1) << (cs.compared ? 100.0 * cs.agreed / cs.compared : 0.0) << "%），全部 "
+                  << cs.allAgreed << "/" << cs.allCompared << "（" << 100.0 * cs.allAgreed / cs.allCompared << "%）"
+                  << std::endl;
+    if (dumpDir) std::cout << "导出样本: " << cs.dumped << " 个 -> " << dumpDir << std::endl;
+}
+
+// -b：对图像（每帧重复同一张）或视频跑 frames 帧，不开窗口，统计每帧的堆分配次数
+int runBenchmark(const char* input, int frames, TessPool& pool) {
+    install_mat_alloc_counter();
+    cv::Mat image = cv::imread(input, cv::IMREAD_COLOR);
+    cv::VideoCapture video;
+    if (image.empty() && !video.open(input)) {
+        std::cerr << "无法读取基准输入: " << input << std::endl;
+        return -1;
+    }
+    
+    OcrWorkspace ws;
+    std::vector<std::pair<std::string, cv::Point>> digits;
+    FrameStats warmup, stats;
+    cv::Mat frame;
+    for (int i = 0; i < BENCH_WARMUP + frames; ++i) {
+        if (!image.empty()) {
+            image.copyTo(frame);   // processFrame 会在帧上画框，每次从原图拷贝
+        } else if (!video.read(frame) || frame.empty()) {
+            break;
+        }
+        processFrame(frame, pool, ws, digits, i < BENCH_WARMUP ? warmup : stats);
+    }
+    if (stats.frames == 0) {
+        std::cerr << "输入不足 " << BENCH_WARMUP + 1 << " 帧" << std::endl;
+        return -1;
+    }
+    
+    printSummary(stats, pool);
+    if (!ALLOC_COUNT_ENABLED) {
+        std::cout << "未启用分配计数：用 make bench（-DOCR_ALLOC_COUNT）编译的 ocr_bench 运行 -b" << std::endl;
+        return 0;
+    }
+    const double n = stats.frames;
+    const AllocSnapshot& pre = stats.preprocessAllocs;
+    const AllocSnapshot& rec = stats.ocrAllocs;
+    std::cout << "每帧堆分配（" << stats.frames << " 帧，预热 " << BENCH_WARMUP << " 帧不计）:\n"
+              << "  预处理: " << std::setprecision(1) << pre.total() / n << " 次（new " << pre.news / n
+              << "，Mat " << pre.mats / n << "），new " << std::setprecision(0) << pre.bytes / n << " 字节\n"
+              << "  识别:   " << std::setprecision(1) << rec.total() / n << " 次（new " << rec.news / n
+              << "，Mat " << rec.mats / n << "），new " << std::setprecision(0) << rec.bytes / n << " 字节" << std::endl;
+    std::cout << "临时区峰值: " << ws.arena.peak_bytes() / 1024 << " KB / " << (ARENA_BYTES >> 10) << " KB，溢出 "
+              << ws.arena.overflow_count() << " 次" << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // OpenMP 版 Tesseract 的线程数只能在加载前通过环境变量限制（见 tess_pool.h），没设置时带上它重新启动
+    if (!getenv("OMP_THREAD_LIMIT")) {
+        setenv("OMP_THREAD_LIMIT", "1", 1);
+        execv("/proc/self/exe", argv);
+        perror("重新启动失败，OpenMP 线程数未限制");
+    }
+    
+    // -j 指定 Tesseract 实例（线程）数，默认每个核心一个
+    int threads = int(std::thread::hardware_concurrency());
+    const char* modelPath = nullptr;
+    const char* trainDir = nullptr;
+    const char* benchInput = nullptr;
+    int benchFrames = 200;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:m:T:AD:BR:N:b:n:h")) != -1) {
+        switch (opt) {
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'm':
+            modelPath = optarg;
+            break;
+        case 'T':
+            trainDir = optarg;
+            break;
+        case 'A':
+            evaluateClassifier = true;
+            break;
+        case 'D':
+            dumpDir = optarg;
+            break;
+        case 'B':
+            batchTesseract = true;
+            break;
+        case 'R':
+            roiCache.refresh_frames = atoi(optarg);
+            break;
+        case 'N':
+            tracker.full_interval = atoi(optarg);
+            break;
+        case 'b':
+            benchInput = optarg;
+            break;
+        case 'n':
+            benchFrames = atoi(optarg);
+            break;
+        default:
+            std::cerr << "用法: " << argv[0] << " [-j 识别线程数] [-m 数字模型 [-A]] [-D 样本目录] [-B] [-R 帧数] [-N 帧数]\n"
+                      << "      " << argv[0] << " -T 样本目录 -m 数字模型   （训练快速分类器）\n"
+                      << "      " << argv[0] << " -b 图像或视频 [-n 帧数] [其他识别选项]   （基准测试；ocr_bench 统计每帧堆分配）\n"
+                      << "  -A 分类器有结果时也跑 Tesseract，统计一致率\n"
+                      << "  -B 一帧中需要 Tesseract 的 ROI 拼成一行一次识别（每个实例一条）\n"
+                      << "  -R 未变化的 ROI 沿用缓存结果，最多沿用的帧数（默认 30，0 关闭缓存）\n"
+                      << "  -N 跟踪模式：每隔这么多帧（或窗口里的数字丢失时）做一次全帧检测，其余帧只处理数字周围\n"
+                      << "  -D 把二值 ROI 按 Tesseract 结果存成 <数字>_<序号>.png，检查后用于 -T" << std::endl;
+            return -1;
+        }
+    }
+    if (trainDir) {
+        if (!modelPath) {
+            std::cerr << "-T 需要用 -m 指定模型输出路径" << std::endl;
+            return -1;
+        }
+        return trainClassifier(trainDir, modelPath) ? 0 : -1;
+    }
+    if (modelPath) {
+        if (!classifier.load(modelPath)) return -1;
+        std::cout << "数字模型: " << classifier.size() << " 个模板" << std::endl;
+    }
+    
+    // 初始化Tesseract OCR：每个识别线程一个实例（单字符模式，只识别数字）
+    TessPool pool;
+    if (!pool.init(threads)) {
+        std::cerr << "无法初始化Tesseract OCR！" << std::endl;
+        return -1;
+    }
+    std::cout << "Tesseract 实例数: " << pool.size() << std::endl;
+    
+    if (benchInput) return runBenchmark(benchInput, benchFrames, pool);
+    
     // 初始化摄像头
     cv::VideoCapture cap(0);
     if (!cap.isOpened()) {
@@ -142,17 +638,6 @@ int main() {
     cap.set(cv::CAP_PROP_FRAME_WIDTH, camWidth);
     cap.set(cv::CAP_PROP_FRAME_HEIGHT, camHeight);
     
-    // 初始化Tesseract OCR
-    tesseract::TessBaseAPI ocr;
-    if (ocr.Init(nullptr, "eng", tesseract::OEM_LSTM_ONLY)) {
-        std::cerr << "无法初始化Tesseract OCR！" << std::endl;
-        return -1;
-    }
-    
-    // 配置OCR参数
-    ocr.SetPageSegMode(tesseract::PSM_SINGLE_CHAR); // 单字符模式
-    ocr.SetVariable("tessedit_char_whitelist", "0123456789"); // 只识别数字
-    
     // 设置屏幕分辨率（根据实际显示器修改）
     cv::Size screenRes(1920, 1080);
     
@@ -160,21 +645,19 @@ int main() {
     cv::namedWindow("Digit Recognition", cv::WINDOW_NORMAL);
     cv::resizeWindow("Digit Recognition", 800, 600);
     
-    cv::Mat frame, processed;
+    cv::Mat frame;
     int frameCount = 0;
     auto startTime = std::chrono::steady_clock::now();
+    OcrWorkspace ws;
+    std::vector<std::pair<std::string, cv::Point>> digits;
+    FrameStats stats;
     
     while (true) {
         cap >> frame;
         if (frame.empty()) break;
         
         frameCount++;
-        
-        // 预处理图像
-        processed = preprocessImage(frame);
-        
-        // 识别数字
-        auto digits = recognizeDigits(frame, processed, ocr);
+        processFrame(frame, pool, ws, digits, stats);
         
         // 显示检测到的数字及其位置
         for (const auto& digit : digits) {
@@ -206,8 +689,9 @@ int main() {
         if (cv::waitKey(1) == 27) break;
     }
     
+    printSummary(stats, pool);
+    
     // 清理资源
-    ocr.End();
     cap.release();
     cv::destroyAllWindows();
     
@@ -0,0 +1,82 @@
+#pragma once
+
+// 识别流程的持久缓冲：
+//   PreprocessWorkspace  预处理的中间图像、CLAHE 实例和结构元素，按帧尺寸分配一次；
+//                        处理窗口时使用同一块缓冲左上角的视图，尺寸变小也不重新分配
+//   ScratchArena         每帧 ROI 的临时图像（灰度、二值、缩放），从一整块内存里顺序切出，
+//                        每帧开始时整体清空；多个识别线程并发切分（原子加）
+// 这里只保证我们自己的代码不再分配，OpenCV 函数内部的临时缓冲不在控制范围内。
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ScratchArena {
+public:
+    // 容量只增不减
+    void init(size_t bytes) {
+        if (bytes <= capacity) return;
+        storage.reset(new uint8_t[bytes + 63]);
+        base = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(storage.get()) + 63) & ~uintptr_t(63));
+        capacity = bytes;
+        used = 0;
+    }
+
+    void reset() {
+        size_t u = used.load(std::memory_order_relaxed);
+        if (u > peak) peak = std::min(u, capacity);
+        used.store(0, std::memory_order_relaxed);
+    }
+
+    // 按 64 字节对齐切出一块；空间不够时返回 nullptr 并计数
+    void* alloc(size_t bytes) {
+        size_t need = (bytes + 63) & ~size_t(63);
+        size_t offset = used.fetch_add(need, std::memory_order_relaxed);
+        if (offset + need > capacity) {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return base + offset;
+    }
+
+    // 以切出的内存为数据的 Mat 头；空间不够时返回空 Mat，调用方的 OpenCV 函数会照常自行分配
+    cv::Mat mat(int rows, int cols, int type) {
+        void* data = alloc(size_t(rows) * cols * CV_ELEM_SIZE(type));
+        return data ? cv::Mat(rows, cols, type, data) : cv::Mat();
+    }
+
+    size_t peak_bytes() const { return peak; }
+    uint64_t overflow_count() const { return overflows.load(std::memory_order_relaxed); }
+
+private:
+    std::unique_ptr<uint8_t[]> storage;
+    uint8_t* base = nullptr;
+    size_t capacity = 0;
+    std::atomic<size_t> used{0};
+    std::atomic<uint64_t> overflows{0};
+    size_t peak = 0;
+};
+
+struct PreprocessWorkspace {
+    cv::Size size;
+    cv::Mat gray, equalized, blurred, edged;
+    cv::Ptr<cv::CLAHE> clahe;
+    cv::Mat kernel;
+    std::vector<std::vector<cv::Point>> contours;   // findContours 的输出，保留容量
+    std::vector<cv::Vec4i> hierarchy;
+
+    void init(const cv::Size& frame) {
+        if (!clahe) {
+            clahe = cv::createCLAHE(2.0, cv::Size(8, 8));
+            kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
+        }
+        if (frame == size) return;
+        size = frame;
+        gray.create(frame, CV_8UC1);
+        equalized.create(frame, CV_8UC1);
+        blurred.create(frame, CV_8UC1);
+        edged.create(frame, CV_8UC1);
+    }
+};
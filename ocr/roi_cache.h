@@ -0,0 +1,110 @@
+#pragma once
+
+// 逐帧 ROI 结果缓存：屏幕上的数字很少变化，位置相近且二值图“看起来一样”的 ROI 直接沿用上次的结果。
+// 签名是二值 ROI 缩到 8x8 后按 128 阈值取的 64 位平均哈希，比较时允许少量位不同（光照、噪声）。
+// 每个条目最多沿用 refresh_frames 帧就强制重新识别一次，限制结果过期的时间；
+// 连续 evict_frames 帧没出现的条目被删除。
+// lookup() 只读，可以在识别线程里并发调用；store()/touch()/end_frame() 只在主线程调用。
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static inline uint64_t roi_signature(const cv::Mat& bin) {
+    uint8_t pixels[64];
+    cv::Mat small(8, 8, CV_8UC1, pixels);   // 栈上缓冲，不分配
+    cv::resize(bin, small, cv::Size(8, 8), 0, 0, cv::INTER_AREA);
+    uint64_t bits = 0;
+    for (int y = 0; y < 8; ++y) {
+        const uint8_t* row = small.ptr<uint8_t>(y);
+        for (int x = 0; x < 8; ++x) bits = (bits << 1) | (row[x] > 127 ? 1 : 0);
+    }
+    return bits;
+}
+
+class RoiCache {
+public:
+    int refresh_frames = 30;      // 条目最多沿用多少帧，0 表示不使用缓存
+    int max_distance = 4;         // 签名允许不同的位数
+    int position_tolerance = 6;   // ROI 位置和尺寸允许的偏差（像素）
+    int evict_frames = 10;
+
+    bool enabled() const { return refresh_frames > 0; }
+
+    void begin_frame() { frame++; }
+
+    // 找到位置相近、签名相近且未到刷新期限的条目时返回 true，并给出缓存的结果
+    bool lookup(const cv::Rect& rect, uint64_t signature, std::string* text) const {
+        lookups++;
+        for (const Entry& e : entries) {
+            if (!near(e.rect, rect) || __builtin_popcountll(e.signature ^ signature) > max_distance) continue;
+            if (frame - e.stored_frame >= refresh_frames) return false;   // 到期，强制重新识别
+            *text = e.text;
+            hits++;
+            return true;
+        }
+        return false;
+    }
+
+    // 新识别的结果：替换同一位置的旧条目或新增
+    void store(const cv::Rect& rect, uint64_t signature, const std::string& text) {
+        Entry* e = find(rect);
+        if (!e) {
+            entries.emplace_back();
+            e = &entries.back();
+        }
+        e->rect = rect;
+        e->signature = signature;
+        e->text = text;
+        e->stored_frame = frame;
+        e->last_seen = frame;
+    }
+
+    // 命中的条目：只记录仍然可见，签名和识别时间保持不变，避免缓慢变化被一点点“带”过去
+    void touch(const cv::Rect& rect) {
+        if (Entry* e = find(rect)) e->last_seen = frame;
+    }
+
+    void end_frame() {
+        for (size_t i = 0; i < entries.size();) {
+            if (frame - entries[i].last_seen >= evict_frames) {
+                entries[i] = entries.back();
+                entries.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    uint64_t lookup_count() const { return lookups; }
+    uint64_t hit_count() const { return hits; }
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry {
+        cv::Rect rect;
+        uint64_t signature;
+        std::string text;
+        int64_t stored_frame;
+        int64_t last_seen;
+    };
+
+    bool near(const cv::Rect& a, const cv::Rect& b) const {
+        return std::abs(a.x - b.x) <= position_tolerance && std::abs(a.y - b.y) <= position_tolerance &&
+               std::abs(a.width - b.width) <= position_tolerance && std::abs(a.height - b.height) <= position_tolerance;
+    }
+
+    Entry* find(const cv::Rect& rect) {
+        for (Entry& e : entries)
+            if (near(e.rect, rect)) return &e;
+        return nullptr;
+    }
+
+    std::vector<Entry> entries;
+    int64_t frame = 0;
+    mutable std::atomic<uint64_t> lookups{0};
+    mutable std::atomic<uint64_t> hits{0};
+};
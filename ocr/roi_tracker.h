@@ -0,0 +1,70 @@
+#pragma once
+
+// ROI 跟踪：数字在画面里几乎不动，全帧检测一次之后，后续帧只预处理上次数字周围扩展出的窗口。
+// 每隔 full_interval 帧，或者某个窗口里没再识别出数字（数字移动或消失），下一帧重新做全帧检测。
+// 相互重叠的窗口合并成一个，避免同一个数字在两个窗口里各被检测一次。
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+class RoiTracker {
+public:
+    int full_interval = 0;   // 每隔多少帧做一次全帧检测，0 表示不跟踪（每帧全帧检测）
+    int padding = 24;        // 窗口在上次数字框四周扩展的像素
+
+    // 本帧能否只处理跟踪窗口
+    bool tracking() const { return full_interval > 0 && !tracks.empty() && !lost && since_full < full_interval; }
+
+    // 本帧要处理的窗口（已裁剪到画面内并合并重叠）
+    void windows(const cv::Size& frame, std::vector<cv::Rect>& out) const {
+        out.clear();
+        const cv::Rect bounds(0, 0, frame.width, frame.height);
+        for (const cv::Rect& t : tracks) {
+            cv::Rect w(t.x - padding, t.y - padding, t.width + 2 * padding, t.height + 2 * padding);
+            out.push_back(w & bounds);
+        }
+        for (size_t i = 0; i < out.size(); ++i) {
+            for (size_t j = i + 1; j < out.size();) {
+                if ((out[i] & out[j]).area() > 0) {
+                    out[i] |= out[j];
+                    out.erase(out.begin() + long(j));
+                    j = i + 1;   // 合并后变大，重新和后面的比较
+                } else {
+                    ++j;
+                }
+            }
+        }
+    }
+
+    // found: 本帧识别出数字的区域；windows: 本帧处理的窗口（全帧检测时为空）
+    void update(const std::vector<cv::Rect>& found, const std::vector<cv::Rect>& windows) {
+        if (windows.empty()) {
+            since_full = 0;
+            full_frames++;
+        } else {
+            since_full++;
+            tracked_frames++;
+        }
+        lost = false;
+        for (const cv::Rect& w : windows) {
+            bool any = false;
+            for (const cv::Rect& r : found) any = any || (w & r).area() > 0;
+            if (!any) {
+                lost = true;
+                lost_count++;
+                break;
+            }
+        }
+        tracks = found;
+    }
+
+    uint64_t full_frames = 0;
+    uint64_t tracked_frames = 0;
+    uint64_t lost_count = 0;   // 因窗口丢失数字而提前全帧检测的次数
+
+private:
+    std::vector<cv::Rect> tracks;   // 上一帧识别出数字的区域
+    int since_full = 0;
+    bool lost = false;
+};
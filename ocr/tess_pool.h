@@ -0,0 +1,131 @@
+#pragma once
+
+// Tesseract 实例池：每个线程一个预先初始化好的 TessBaseAPI（单字符模式 + 数字白名单），
+// 一帧里的所有 ROI 分给各线程并行识别。TessBaseAPI 本身不是线程安全的，但不同实例可以并发使用。
+// 调用线程自己也参与识别（使用第 0 个实例），所以 N 个实例只需要 N-1 个后台线程。
+// Tesseract 若带 OpenMP 编译，每个实例还会再开线程，和这里的并行叠加反而更慢。libgomp 在程序加载时
+// 就读取环境变量，进程内 setenv 无效，必须在启动环境里设置 OMP_THREAD_LIMIT=1（ocr 会带着它重新 exec 自己）。
+
+#include <tesseract/baseapi.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class TessPool {
+public:
+
+    ~TessPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start_cv.notify_all();
+        for (auto& t : workers) t.join();
+        for (auto& api : apis) api->End();
+    }
+
+    // 创建 count 个实例，任一初始化失败返回 false
+    bool init(int count, const char* lang = "eng") {
+        if (count < 1) count = 1;
+        for (int i = 0; i < count; ++i) {
+            std::unique_ptr<tesseract::TessBaseAPI> api(new tesseract::TessBaseAPI);
+            if (api->Init(nullptr, lang, tesseract::OEM_LSTM_ONLY)) return false;
+            api->SetPageSegMode(tesseract::PSM_SINGLE_CHAR); // 单字符模式
+            api->SetVariable("tessedit_char_whitelist", "0123456789"); // 只识别数字
+            apis.push_back(std::move(api));
+        }
+        for (int i = 1; i < count; ++i) workers.emplace_back(&TessPool::worker, this, i);
+        return true;
+    }
+
+    int size() const { return int(apis.size()); }
+
+    // 对 0..count-1 并行调用 fn(实例, 下标)，全部完成后返回。
+    // 通过函数指针 + 上下文指针调用，不经过 std::function，捕获再多也不会分配堆内存
+    template <typename F>
+    void for_each(size_t count, F&& fn) {
+        if (count == 0) return;
+        if (count == 1 || workers.empty()) {
+            for (size_t i = 0; i < count; ++i) fn(*apis[0], i);
+            return;
+        }
+        using Fn = typename std::remove_reference<F>::type;
+        Task task = {[](void* ctx, tesseract::TessBaseAPI& api, size_t i) { (*static_cast<Fn*>(ctx))(api, i); },
+                     const_cast<void*>(static_cast<const void*>(&fn))};
+        {
+            // 上一轮醒得晚的线程可能还在 run() 里（已经领不到下标），等它们退出再换任务
+            std::unique_lock<std::mutex> lock(mutex);
+            done_cv.wait(lock, [&] { return active == 0; });
+            current = &task;
+            total = count;
+            next = 0;
+            remaining = count;
+            generation++;
+        }
+        start_cv.notify_all();
+        run(*apis[0], task, count);
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [&] { return remaining == 0; });
+        current = nullptr;   // task 在本函数返回后失效
+    }
+
+private:
+    struct Task {
+        void (*call)(void*, tesseract::TessBaseAPI&, size_t);
+        void* ctx;
+        void operator()(tesseract::TessBaseAPI& api, size_t i) const { call(ctx, api, i); }
+    };
+
+    // 领取下标直到领完；完成最后一个的线程负责唤醒调用方
+    void run(tesseract::TessBaseAPI& api, const Task& task, size_t count) {
+        size_t finished = 0;
+        for (size_t i; (i = next.fetch_add(1)) < count;) {
+            task(api, i);
+            finished++;
+        }
+        if (finished > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            remaining -= finished;
+            if (remaining == 0) done_cv.notify_all();
+        }
+    }
+
+    void worker(int index) {
+        uint64_t seen = 0;
+        for (;;) {
+            Task task;
+            size_t count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start_cv.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                if (!current) continue;   // 醒得太晚，这一轮已经结束
+                task = *current;
+                count = total;
+                active++;
+            }
+            run(*apis[index], task, count);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--active == 0) done_cv.notify_all();
+        }
+    }
+
+    std::vector<std::unique_ptr<tesseract::TessBaseAPI>> apis;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    const Task* current = nullptr;
+    size_t total = 0;
+    std::atomic<size_t> next{0};
+    size_t remaining = 0;
+    int active = 0;             // 正在 run() 中的后台线程数
+    uint64_t generation = 0;
+    bool stopping = false;
+};